@@ -2,4 +2,766 @@
 
 
 #include "MmdAnimationSequence.h"
+#include "Animation/Skeleton.h"
+#include "Animation/MorphTarget.h"
+#include "Async/ParallelFor.h"
+#include "Engine/SkeletalMesh.h"
+#include "MmdBoneNameMapping.h"
+#include "Misc/ScopeLock.h"
+#include "Templates/IdentityFunctor.h"
 #include "poml.h"
+
+namespace
+{
+	// Longest run of keys which ReduceKeys merges into one segment.
+	constexpr int32 MaxReducedSpan = 256;
+
+	// Control point x candidates for fitting, on the VMD grid.
+	constexpr uint8 FitGrid[] = { 0, 16, 32, 48, 64, 80, 96, 112, 127 };
+
+	struct FBoneKeyFitter
+	{
+		const TArray<FMmdBoneKey>& Keys;
+		float PositionTolerance;
+		float AngleTolerance;
+
+		TArray<float> Times;
+		TArray<float> Alphas;
+
+		// Finds a curve on the VMD grid which Check accepts, trying Hint first and then least squares fits of Alphas.
+		// Candidates are bound before they are checked, so that Check sees the sample table which playback will use.
+		template<typename CheckFunc>
+		bool FitInterpolation(const FMmdInterpolation& Hint, CheckFunc&& Check, FMmdInterpolation& OutInterpolation) const
+		{
+			FMmdInterpolation BoundHint = Hint;
+			BoundHint.Bind();
+			if (Check(BoundHint))
+			{
+				OutInterpolation = BoundHint;
+				return true;
+			}
+
+			for (uint8 QX1 : FitGrid)
+			{
+				for (uint8 QX2 : FitGrid)
+				{
+					const float X1 = QX1 / 127.f;
+					const float X2 = QX2 / 127.f;
+
+					// y(t) = B1(t) * Y1 + B2(t) * Y2 + t^3 is linear in Y1 and Y2.
+					double S11 = 0.0, S12 = 0.0, S22 = 0.0, R1 = 0.0, R2 = 0.0;
+					for (int32 i = 0; i < Times.Num(); ++i)
+					{
+						const double T = poml::calc_bezier_param(Times[i], X1, X2);
+						const double B1 = 3.0 * (1.0 - T) * (1.0 - T) * T;
+						const double B2 = 3.0 * (1.0 - T) * T * T;
+						const double R = Alphas[i] - T * T * T;
+						S11 += B1 * B1;
+						S12 += B1 * B2;
+						S22 += B2 * B2;
+						R1 += B1 * R;
+						R2 += B2 * R;
+					}
+
+					const double Det = S11 * S22 - S12 * S12;
+					if (FMath::Abs(Det) < UE_DOUBLE_SMALL_NUMBER)
+					{
+						continue;
+					}
+
+					const double Y1 = (R1 * S22 - R2 * S12) / Det;
+					const double Y2 = (R2 * S11 - R1 * S12) / Det;
+
+					FMmdInterpolation Candidate;
+					Candidate.X1 = X1;
+					Candidate.X2 = X2;
+					Candidate.Y1 = FMath::Clamp(FMath::RoundToInt32(Y1 * 127.0), 0, 127) / 127.f;
+					Candidate.Y2 = FMath::Clamp(FMath::RoundToInt32(Y2 * 127.0), 0, 127) / 127.f;
+					Candidate.Bind();
+
+					if (Check(Candidate))
+					{
+						OutInterpolation = Candidate;
+						return true;
+					}
+				}
+			}
+
+			return false;
+		}
+
+		bool FitLocationAxis(int32 First, int32 Last, int32 Axis, const FMmdInterpolation& Hint, FMmdInterpolation& OutInterpolation)
+		{
+			const double V0 = Keys[First].Location[Axis];
+			const double V1 = Keys[Last].Location[Axis];
+			const double Range = V1 - V0;
+
+			for (int32 i = First + 1; i < Last; ++i)
+			{
+				Alphas[i - First - 1] = FMath::Abs(Range) > UE_DOUBLE_SMALL_NUMBER ? FMath::Clamp((Keys[i].Location[Axis] - V0) / Range, 0.0, 1.0) : 0.f;
+			}
+
+			auto Check = [&](const FMmdInterpolation& Interpolation)
+			{
+				for (int32 i = First + 1; i < Last; ++i)
+				{
+					const double Value = FMath::Lerp(V0, V1, static_cast<double>(Interpolation.AlphaAt(Times[i - First - 1])));
+					if (FMath::Abs(Value - Keys[i].Location[Axis]) > PositionTolerance)
+					{
+						return false;
+					}
+				}
+				return true;
+			};
+
+			return FitInterpolation(Hint, Check, OutInterpolation);
+		}
+
+		bool FitRotation(int32 First, int32 Last, const FMmdInterpolation& Hint, FMmdInterpolation& OutInterpolation)
+		{
+			const FQuat& Q0 = Keys[First].Rotation;
+			const FQuat& Q1 = Keys[Last].Rotation;
+			const double Angle = Q0.AngularDistance(Q1);
+
+			for (int32 i = First + 1; i < Last; ++i)
+			{
+				Alphas[i - First - 1] = Angle > UE_DOUBLE_SMALL_NUMBER ? FMath::Clamp(Q0.AngularDistance(Keys[i].Rotation) / Angle, 0.0, 1.0) : 0.f;
+			}
+
+			auto Check = [&](const FMmdInterpolation& Interpolation)
+			{
+				for (int32 i = First + 1; i < Last; ++i)
+				{
+					const FQuat Rotation = Interpolation.Interp(Q0, Q1, Times[i - First - 1]);
+					if (FMath::RadiansToDegrees(Rotation.AngularDistance(Keys[i].Rotation)) > AngleTolerance)
+					{
+						return false;
+					}
+				}
+				return true;
+			};
+
+			return FitInterpolation(Hint, Check, OutInterpolation);
+		}
+
+		// Fits Keys[Last] so that the segment from Keys[First] reproduces every key in between.
+		bool FitSegment(int32 First, int32 Last, FMmdBoneKey& OutKey)
+		{
+			const int32 NumInner = Last - First - 1;
+			Times.SetNumUninitialized(NumInner, EAllowShrinking::No);
+			Alphas.SetNumUninitialized(NumInner, EAllowShrinking::No);
+
+			const float Length = static_cast<float>(Keys[Last].Frame - Keys[First].Frame);
+			if (Length <= 0.f)
+			{
+				return false;
+			}
+
+			for (int32 i = 0; i < NumInner; ++i)
+			{
+				Times[i] = (Keys[First + 1 + i].Frame - Keys[First].Frame) / Length;
+			}
+
+			OutKey = Keys[Last];
+			return FitLocationAxis(First, Last, 0, Keys[Last].LocationXInterpolation, OutKey.LocationXInterpolation)
+				&& FitLocationAxis(First, Last, 1, Keys[Last].LocationYInterpolation, OutKey.LocationYInterpolation)
+				&& FitLocationAxis(First, Last, 2, Keys[Last].LocationZInterpolation, OutKey.LocationZInterpolation)
+				&& FitRotation(First, Last, Keys[Last].RotationInterpolation, OutKey.RotationInterpolation);
+		}
+	};
+
+	// Smallest three quaternion components in 15 bits each, the index of the dropped largest one in the top bits of Out[0] and Out[1].
+	void EncodeRotation(const FQuat& Rotation, uint16* Out)
+	{
+		const FQuat Normalized = Rotation.GetNormalized();
+		const double Components[4] = { Normalized.X, Normalized.Y, Normalized.Z, Normalized.W };
+
+		int32 Largest = 0;
+		for (int32 i = 1; i < 4; ++i)
+		{
+			if (FMath::Abs(Components[i]) > FMath::Abs(Components[Largest]))
+			{
+				Largest = i;
+			}
+		}
+
+		// q and -q are the same rotation, so the dropped component is made positive.
+		const double Sign = Components[Largest] < 0.0 ? -1.0 : 1.0;
+
+		for (int32 i = 0, OutIndex = 0; i < 4; ++i)
+		{
+			if (i != Largest)
+			{
+				const double Unit = Components[i] * Sign * UE_DOUBLE_SQRT_2 * 0.5 + 0.5;
+				Out[OutIndex++] = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt32(Unit * 32767.0), 0, 32767));
+			}
+		}
+
+		Out[0] |= (Largest & 1) << 15;
+		Out[1] |= (Largest >> 1) << 15;
+	}
+
+	FQuat DecodeRotation(const uint16* In)
+	{
+		const int32 Largest = (In[0] >> 15) | ((In[1] >> 15) << 1);
+
+		double Components[4];
+		double SquaredSum = 0.0;
+		for (int32 i = 0, InIndex = 0; i < 4; ++i)
+		{
+			if (i != Largest)
+			{
+				const double Value = ((In[InIndex++] & 0x7FFF) / 32767.0 * 2.0 - 1.0) * UE_DOUBLE_INV_SQRT_2;
+				Components[i] = Value;
+				SquaredSum += Value * Value;
+			}
+		}
+		Components[Largest] = FMath::Sqrt(FMath::Max(0.0, 1.0 - SquaredSum));
+
+		return FQuat(Components[0], Components[1], Components[2], Components[3]);
+	}
+
+	uint32 QuantizeCurve(const FMmdInterpolation& Interpolation)
+	{
+		auto Quantize = [](float Value)
+		{
+			return static_cast<uint32>(FMath::Clamp(FMath::RoundToInt32(Value * 127.f), 0, 127));
+		};
+
+		return Quantize(Interpolation.X1) | (Quantize(Interpolation.Y1) << 8) | (Quantize(Interpolation.X2) << 16) | (Quantize(Interpolation.Y2) << 24);
+	}
+
+	void SampleCompressedBoneKeys(const FMmdCompressedBoneKeys& Keys, float Frame, FMmdKeyCursor& Cursor, FTransform& OutTransform)
+	{
+		const int32 FrameNo = FMath::FloorToInt32(Frame);
+		const float Subframe = Frame - static_cast<float>(FrameNo);
+
+		const int32 Index1 = Cursor.Seek(Keys.Frames, FrameNo, FIdentityFunctor());
+		const int32 Key0 = FMath::Clamp(Index1 - 1, 0, Keys.Num() - 1);
+		const int32 Key1 = FMath::Clamp(Index1, 0, Keys.Num() - 1);
+
+		const int32 Frame0 = Keys.Frames[Key0];
+		const int32 Frame1 = Keys.Frames[Key1];
+		if (Frame0 == Frame1)
+		{
+			OutTransform = FTransform(Keys.GetRotation(Key0), Keys.GetLocation(Key0));
+			return;
+		}
+
+		const float Time = (FrameNo - Frame0 + Subframe) / (Frame1 - Frame0);
+		const uint16* CurveIndices = &Keys.CurveIndices[Key1 * 4];
+
+		const FVector Location0 = Keys.GetLocation(Key0);
+		const FVector Location1 = Keys.GetLocation(Key1);
+
+		FVector Location;
+		Location.X = Keys.BoundCurves[CurveIndices[0]].Interp(Location0.X, Location1.X, Time);
+		Location.Y = Keys.BoundCurves[CurveIndices[1]].Interp(Location0.Y, Location1.Y, Time);
+		Location.Z = Keys.BoundCurves[CurveIndices[2]].Interp(Location0.Z, Location1.Z, Time);
+		FQuat Rotation = Keys.BoundCurves[CurveIndices[3]].Interp(Keys.GetRotation(Key0), Keys.GetRotation(Key1), Time);
+
+		OutTransform = FTransform(Rotation, Location);
+	}
+
+	void SampleBoneKeys(const FMmdBoneTrack& Track, float Frame, FMmdKeyCursor& Cursor, FTransform& OutTransform)
+	{
+		if (Track.IsCompressed())
+		{
+			SampleCompressedBoneKeys(Track.CompressedKeys, Frame, Cursor, OutTransform);
+			return;
+		}
+
+		const TArray<FMmdBoneKey>& Keys = Track.Keys;
+
+		if (Keys.IsEmpty())
+		{
+			OutTransform = FTransform::Identity;
+			return;
+		}
+
+		const int32 FrameNo = FMath::FloorToInt32(Frame);
+		const float Subframe = Frame - static_cast<float>(FrameNo);
+
+		auto [Key0, Key1] = Cursor.FindKeyByFrame(Keys, FrameNo);
+		if (Key0.Frame == Key1.Frame)
+		{
+			OutTransform = FTransform(Key0.Rotation, Key0.Location);
+			return;
+		}
+
+		const float Time = (FrameNo - Key0.Frame + Subframe) / (Key1.Frame - Key0.Frame);
+
+		FVector Location;
+		Location.X = Key1.LocationXInterpolation.Interp(Key0.Location.X, Key1.Location.X, Time);
+		Location.Y = Key1.LocationYInterpolation.Interp(Key0.Location.Y, Key1.Location.Y, Time);
+		Location.Z = Key1.LocationZInterpolation.Interp(Key0.Location.Z, Key1.Location.Z, Time);
+		FQuat Rotation = Key1.RotationInterpolation.Interp(Key0.Rotation, Key1.Rotation, Time);
+
+		OutTransform = FTransform(Rotation, Location);
+	}
+}
+
+void UMmdAnimationSequence::PostLoad()
+{
+	Super::PostLoad();
+
+	BindInterpolations();
+	CacheTrackNames();
+}
+
+#if WITH_EDITOR
+void UMmdAnimationSequence::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	if (PropertyChangedEvent.GetPropertyName() == GET_MEMBER_NAME_CHECKED(UMmdAnimationSequence, bCompressBoneKeys))
+	{
+		UpdateBoneKeyCompression();
+	}
+
+	BindInterpolations();
+	CacheTrackNames();
+}
+#endif
+
+void UMmdAnimationSequence::BindInterpolations()
+{
+	for (FMmdBoneTrack& Track : BoneTracks)
+	{
+		for (FMmdBoneKey& Key : Track.Keys)
+		{
+			Key.LocationXInterpolation.Bind();
+			Key.LocationYInterpolation.Bind();
+			Key.LocationZInterpolation.Bind();
+			Key.RotationInterpolation.Bind();
+		}
+
+		Track.CompressedKeys.Bind();
+	}
+}
+
+void UMmdAnimationSequence::UpdateBoneKeyCompression()
+{
+	for (FMmdBoneTrack& Track : BoneTracks)
+	{
+		if (bCompressBoneKeys && !Track.IsCompressed())
+		{
+			Track.Compress();
+		}
+		else if (!bCompressBoneKeys && Track.IsCompressed())
+		{
+			Track.Decompress();
+		}
+	}
+
+	BindInterpolations();
+}
+
+void UMmdAnimationSequence::CacheTrackNames()
+{
+	BoneTrackNames.Reset(BoneTracks.Num());
+	for (const FMmdBoneTrack& Track : BoneTracks)
+	{
+		BoneTrackNames.Add(FName(Track.Name));
+	}
+
+	MorphTrackNames.Reset(MorphTracks.Num());
+	for (const FMmdMorphTrack& Track : MorphTracks)
+	{
+		MorphTrackNames.Add(FName(Track.Name));
+	}
+
+	FScopeLock Lock(&BindingLock);
+	Bindings.Reset();
+}
+
+template<typename GetNameFunc, typename ResolveFunc>
+TSharedRef<const TArray<int32>> UMmdAnimationSequence::FindOrAddBinding(const UObject* Target, int32 NumTargets, GetNameFunc&& GetTargetName, const UMmdBoneNameMapping* Mapping, ResolveFunc&& Resolve) const
+{
+	const uint32 MappingRevision = Mapping ? Mapping->GetRevision() : 0;
+	const auto Key = MakeTuple(TObjectKey<UObject>(Target), TObjectKey<UMmdBoneNameMapping>(Mapping));
+
+	// A reimported target can keep its count while its bones or morph targets are renamed or reordered.
+	auto IsValid = [NumTargets, MappingRevision, &GetTargetName](const FTrackBinding& Binding)
+	{
+		if (Binding.TargetNames.Num() != NumTargets || Binding.MappingRevision != MappingRevision)
+		{
+			return false;
+		}
+
+		for (int32 Index = 0; Index < NumTargets; ++Index)
+		{
+			if (Binding.TargetNames[Index] != GetTargetName(Index))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	};
+
+	FScopeLock Lock(&BindingLock);
+
+	if (const FTrackBinding* Binding = Bindings.Find(Key); Binding && IsValid(*Binding))
+	{
+		return Binding->Indices;
+	}
+
+	// Drop the bindings of destroyed targets and mappings before resolving.
+	for (auto It = Bindings.CreateIterator(); It; ++It)
+	{
+		const auto& [TargetKey, MappingKey] = It.Key();
+		if (!TargetKey.ResolveObjectPtr() || (MappingKey != TObjectKey<UMmdBoneNameMapping>() && !MappingKey.ResolveObjectPtr()))
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	FTrackBinding& Binding = Bindings.FindOrAdd(Key);
+	Binding.MappingRevision = MappingRevision;
+	Binding.TargetNames.Reset(NumTargets);
+	for (int32 Index = 0; Index < NumTargets; ++Index)
+	{
+		Binding.TargetNames.Add(GetTargetName(Index));
+	}
+	Binding.Indices = MakeShared<const TArray<int32>>(Resolve());
+
+	return Binding.Indices;
+}
+
+TSharedRef<const TArray<int32>> UMmdAnimationSequence::GetBoneIndices(const USkeleton* Skeleton, const UMmdBoneNameMapping* Mapping) const
+{
+	check(Skeleton != nullptr);
+	check(BoneTrackNames.Num() == BoneTracks.Num());
+
+	const FReferenceSkeleton& RefSkeleton = Skeleton->GetReferenceSkeleton();
+
+	auto GetBoneName = [&RefSkeleton](int32 BoneIndex)
+	{
+		return RefSkeleton.GetBoneName(BoneIndex);
+	};
+
+	return FindOrAddBinding(Skeleton, RefSkeleton.GetNum(), GetBoneName, Mapping, [this, &RefSkeleton, Mapping]()
+		{
+			TArray<int32> BoneIndices;
+			BoneIndices.Reserve(BoneTrackNames.Num());
+
+			// Tracks are sampled in parallel into bone-indexed buffers, so no bone may have two tracks.
+			TBitArray<> IsBound(false, RefSkeleton.GetNum());
+
+			for (int32 TrackIndex = 0; TrackIndex < BoneTracks.Num(); ++TrackIndex)
+			{
+				const FName Name = Mapping ? Mapping->MapBoneName(BoneTracks[TrackIndex].Name) : BoneTrackNames[TrackIndex];
+
+				int32 BoneIndex = RefSkeleton.FindBoneIndex(Name);
+				if (BoneIndex != INDEX_NONE && IsBound[BoneIndex])
+				{
+					BoneIndex = INDEX_NONE;
+				}
+				else if (BoneIndex != INDEX_NONE)
+				{
+					IsBound[BoneIndex] = true;
+				}
+
+				BoneIndices.Add(BoneIndex);
+			}
+
+			return BoneIndices;
+		});
+}
+
+TSharedRef<const TArray<int32>> UMmdAnimationSequence::GetMorphTargetIndices(const USkeletalMesh* Mesh, const UMmdBoneNameMapping* Mapping) const
+{
+	check(Mesh != nullptr);
+	check(MorphTrackNames.Num() == MorphTracks.Num());
+
+	const auto& MorphTargets = Mesh->GetMorphTargets();
+	auto GetMorphTargetName = [&MorphTargets](int32 Index)
+	{
+		return MorphTargets[Index]->GetFName();
+	};
+
+	return FindOrAddBinding(Mesh, MorphTargets.Num(), GetMorphTargetName, Mapping, [this, Mesh, Mapping]()
+		{
+			TArray<int32> MorphTargetIndices;
+			MorphTargetIndices.Reserve(MorphTrackNames.Num());
+
+			for (int32 TrackIndex = 0; TrackIndex < MorphTracks.Num(); ++TrackIndex)
+			{
+				const FName Name = Mapping ? Mapping->MapMorphName(MorphTracks[TrackIndex].Name) : MorphTrackNames[TrackIndex];
+
+				int32 Index = INDEX_NONE;
+				Mesh->FindMorphTargetAndIndex(Name, Index);
+				MorphTargetIndices.Add(Index);
+			}
+
+			return MorphTargetIndices;
+		});
+}
+
+void UMmdAnimationSequence::SampleBoneTrack(int32 TrackIndex, float Frame, FTransform& OutTransform) const
+{
+	FMmdKeyCursor Cursor;
+	SampleBoneTrack(TrackIndex, Frame, Cursor, OutTransform);
+}
+
+void UMmdAnimationSequence::SampleBoneTrack(int32 TrackIndex, float Frame, FMmdKeyCursor& Cursor, FTransform& OutTransform) const
+{
+	check(BoneTracks.IsValidIndex(TrackIndex));
+
+	SampleBoneKeys(BoneTracks[TrackIndex], Frame, Cursor, OutTransform);
+}
+
+void UMmdAnimationSequence::SampleBoneTracks(float Frame, TArrayView<FTransform> OutPose, bool bParallel) const
+{
+	check(OutPose.Num() >= BoneTracks.Num());
+
+	ParallelFor(BoneTracks.Num(), [this, Frame, OutPose](int32 TrackIndex)
+		{
+			FMmdKeyCursor Cursor;
+			SampleBoneKeys(BoneTracks[TrackIndex], Frame, Cursor, OutPose[TrackIndex]);
+		}, !bParallel);
+}
+
+void UMmdAnimationSequence::SampleBoneTracks(float Frame, TArrayView<FMmdKeyCursor> Cursors, TArrayView<FTransform> OutPose, bool bParallel) const
+{
+	check(Cursors.Num() >= BoneTracks.Num());
+	check(OutPose.Num() >= BoneTracks.Num());
+
+	ParallelFor(BoneTracks.Num(), [this, Frame, Cursors, OutPose](int32 TrackIndex)
+		{
+			SampleBoneKeys(BoneTracks[TrackIndex], Frame, Cursors[TrackIndex], OutPose[TrackIndex]);
+		}, !bParallel);
+}
+
+bool FMmdCompressedBoneKeys::Compress(const TArray<FMmdBoneKey>& Keys)
+{
+	const int32 NumKeys = Keys.Num();
+
+	TMap<uint32, uint16> CurveIndexMap;
+	TArray<uint16> NewCurveIndices;
+	TArray<uint8> NewCurves;
+	NewCurveIndices.SetNumUninitialized(NumKeys * 4);
+
+	for (int32 KeyIndex = 0; KeyIndex < NumKeys; ++KeyIndex)
+	{
+		const FMmdBoneKey& Key = Keys[KeyIndex];
+		const FMmdInterpolation* KeyCurves[] = { &Key.LocationXInterpolation, &Key.LocationYInterpolation, &Key.LocationZInterpolation, &Key.RotationInterpolation };
+
+		for (int32 i = 0; i < 4; ++i)
+		{
+			const uint32 Curve = QuantizeCurve(*KeyCurves[i]);
+			if (const uint16* Found = CurveIndexMap.Find(Curve))
+			{
+				NewCurveIndices[KeyIndex * 4 + i] = *Found;
+				continue;
+			}
+
+			if (CurveIndexMap.Num() > MAX_uint16)
+			{
+				return false;
+			}
+
+			const uint16 CurveIndex = static_cast<uint16>(CurveIndexMap.Num());
+			CurveIndexMap.Add(Curve, CurveIndex);
+			NewCurves.Append({ uint8(Curve), uint8(Curve >> 8), uint8(Curve >> 16), uint8(Curve >> 24) });
+			NewCurveIndices[KeyIndex * 4 + i] = CurveIndex;
+		}
+	}
+
+	FVector3f Min(TNumericLimits<float>::Max());
+	FVector3f Max(TNumericLimits<float>::Lowest());
+	for (const FMmdBoneKey& Key : Keys)
+	{
+		Min = FVector3f::Min(Min, FVector3f(Key.Location));
+		Max = FVector3f::Max(Max, FVector3f(Key.Location));
+	}
+
+	LocationMin = NumKeys > 0 ? Min : FVector3f::ZeroVector;
+	LocationScale = NumKeys > 0 ? (Max - Min) / 65535.f : FVector3f::ZeroVector;
+
+	Frames.SetNumUninitialized(NumKeys);
+	Locations.SetNumUninitialized(NumKeys * 3);
+	Rotations.SetNumUninitialized(NumKeys * 3);
+
+	for (int32 KeyIndex = 0; KeyIndex < NumKeys; ++KeyIndex)
+	{
+		const FMmdBoneKey& Key = Keys[KeyIndex];
+		Frames[KeyIndex] = Key.Frame;
+
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			const float Scale = LocationScale[Axis];
+			const float Value = Scale > 0.f ? (static_cast<float>(Key.Location[Axis]) - LocationMin[Axis]) / Scale : 0.f;
+			Locations[KeyIndex * 3 + Axis] = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt32(Value), 0, 65535));
+		}
+
+		EncodeRotation(Key.Rotation, &Rotations[KeyIndex * 3]);
+	}
+
+	CurveIndices = MoveTemp(NewCurveIndices);
+	Curves = MoveTemp(NewCurves);
+	Bind();
+
+	return true;
+}
+
+void FMmdCompressedBoneKeys::Decompress(TArray<FMmdBoneKey>& OutKeys) const
+{
+	OutKeys.SetNum(Num());
+
+	for (int32 KeyIndex = 0; KeyIndex < Num(); ++KeyIndex)
+	{
+		FMmdBoneKey& Key = OutKeys[KeyIndex];
+		Key.Frame = Frames[KeyIndex];
+		Key.Location = GetLocation(KeyIndex);
+		Key.Rotation = GetRotation(KeyIndex);
+
+		auto GetCurve = [this, KeyIndex](int32 i)
+		{
+			const uint8* Curve = &Curves[CurveIndices[KeyIndex * 4 + i] * 4];
+			return FMmdInterpolation{ Curve[0] / 127.f, Curve[1] / 127.f, Curve[2] / 127.f, Curve[3] / 127.f };
+		};
+
+		Key.LocationXInterpolation = GetCurve(0);
+		Key.LocationYInterpolation = GetCurve(1);
+		Key.LocationZInterpolation = GetCurve(2);
+		Key.RotationInterpolation = GetCurve(3);
+	}
+}
+
+void FMmdCompressedBoneKeys::Bind()
+{
+	BoundCurves.SetNum(Curves.Num() / 4);
+
+	for (int32 CurveIndex = 0; CurveIndex < BoundCurves.Num(); ++CurveIndex)
+	{
+		const uint8* Curve = &Curves[CurveIndex * 4];
+		BoundCurves[CurveIndex] = FMmdInterpolation{ Curve[0] / 127.f, Curve[1] / 127.f, Curve[2] / 127.f, Curve[3] / 127.f };
+		BoundCurves[CurveIndex].Bind();
+	}
+}
+
+FVector FMmdCompressedBoneKeys::GetLocation(int32 Index) const
+{
+	const uint16* Location = &Locations[Index * 3];
+	return FVector(LocationMin + LocationScale * FVector3f(Location[0], Location[1], Location[2]));
+}
+
+FQuat FMmdCompressedBoneKeys::GetRotation(int32 Index) const
+{
+	return DecodeRotation(&Rotations[Index * 3]);
+}
+
+bool FMmdBoneTrack::Compress()
+{
+	if (!CompressedKeys.Compress(Keys))
+	{
+		return false;
+	}
+
+	Keys.Empty();
+	return true;
+}
+
+void FMmdBoneTrack::Decompress()
+{
+	CompressedKeys.Decompress(Keys);
+	CompressedKeys = FMmdCompressedBoneKeys();
+}
+
+void UMmdAnimationSequence::SampleBonePose(float Frame, const USkeleton* Skeleton, const UMmdBoneNameMapping* Mapping, TArrayView<FTransform> OutBoneTransforms, bool bParallel) const
+{
+	const TSharedRef<const TArray<int32>> BoneIndices = GetBoneIndices(Skeleton, Mapping);
+	check(OutBoneTransforms.Num() >= Skeleton->GetReferenceSkeleton().GetNum());
+
+	ParallelFor(BoneTracks.Num(), [this, Frame, &BoneIndices, OutBoneTransforms](int32 TrackIndex)
+		{
+			const int32 BoneIndex = (*BoneIndices)[TrackIndex];
+			if (BoneIndex != INDEX_NONE)
+			{
+				FMmdKeyCursor Cursor;
+				SampleBoneKeys(BoneTracks[TrackIndex], Frame, Cursor, OutBoneTransforms[BoneIndex]);
+			}
+		}, !bParallel);
+}
+
+void UMmdAnimationSequence::SampleBonePose(float Frame, const USkeleton* Skeleton, const UMmdBoneNameMapping* Mapping, TArrayView<FMmdKeyCursor> Cursors, TArrayView<FTransform> OutBoneTransforms, bool bParallel) const
+{
+	const TSharedRef<const TArray<int32>> BoneIndices = GetBoneIndices(Skeleton, Mapping);
+	check(Cursors.Num() >= BoneTracks.Num());
+	check(OutBoneTransforms.Num() >= Skeleton->GetReferenceSkeleton().GetNum());
+
+	ParallelFor(BoneTracks.Num(), [this, Frame, &BoneIndices, Cursors, OutBoneTransforms](int32 TrackIndex)
+		{
+			const int32 BoneIndex = (*BoneIndices)[TrackIndex];
+			if (BoneIndex != INDEX_NONE)
+			{
+				SampleBoneKeys(BoneTracks[TrackIndex], Frame, Cursors[TrackIndex], OutBoneTransforms[BoneIndex]);
+			}
+		}, !bParallel);
+}
+
+int32 FMmdBoneTrack::ReduceKeys(float PositionTolerance, float AngleToleranceDegrees)
+{
+	const int32 NumKeys = Keys.Num();
+	if (NumKeys <= 2 || IsCompressed())
+	{
+		return 0;
+	}
+
+	FBoneKeyFitter Fitter{ Keys, PositionTolerance, AngleToleranceDegrees };
+
+	TArray<FMmdBoneKey> Reduced;
+	Reduced.Reserve(NumKeys);
+	Reduced.Add(Keys[0]);
+
+	FMmdBoneKey Fitted;
+	for (int32 Anchor = 0; Anchor < NumKeys - 1;)
+	{
+		// Extend the segment exponentially while it fits, then binary search the longest fitting one.
+		int32 Best = Anchor + 1;
+		FMmdBoneKey BestKey = Keys[Best];
+		int32 Failed = INDEX_NONE;
+
+		for (int32 Step = 2; Best < NumKeys - 1 && Best - Anchor < MaxReducedSpan; Step *= 2)
+		{
+			const int32 Last = FMath::Min3(Anchor + Step, NumKeys - 1, Anchor + MaxReducedSpan);
+			if (!Fitter.FitSegment(Anchor, Last, Fitted))
+			{
+				Failed = Last;
+				break;
+			}
+
+			Best = Last;
+			BestKey = Fitted;
+		}
+
+		if (Failed != INDEX_NONE)
+		{
+			int32 Low = Best;
+			int32 High = Failed;
+			while (High - Low > 1)
+			{
+				const int32 Mid = (Low + High) / 2;
+				if (Fitter.FitSegment(Anchor, Mid, Fitted))
+				{
+					Low = Mid;
+					BestKey = Fitted;
+				}
+				else
+				{
+					High = Mid;
+				}
+			}
+			Best = Low;
+		}
+
+		Reduced.Add(BestKey);
+		Anchor = Best;
+	}
+
+	const int32 NumRemoved = NumKeys - Reduced.Num();
+	Keys = MoveTemp(Reduced);
+	return NumRemoved;
+}
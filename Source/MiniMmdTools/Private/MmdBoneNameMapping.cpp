@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MmdBoneNameMapping.h"
+
+namespace
+{
+	// Standard MMD bone names without side prefix and their names in MMD Tools.
+	const TCHAR* const DefaultBoneNames[][2] = {
+		{ TEXT("全ての親"), TEXT("ParentNode") },
+		{ TEXT("操作中心"), TEXT("ControlNode") },
+		{ TEXT("センター"), TEXT("center") },
+		{ TEXT("グルーブ"), TEXT("groove") },
+		{ TEXT("腰"), TEXT("waist") },
+		{ TEXT("下半身"), TEXT("lower body") },
+		{ TEXT("上半身"), TEXT("upper body") },
+		{ TEXT("上半身2"), TEXT("upper body2") },
+		{ TEXT("首"), TEXT("neck") },
+		{ TEXT("頭"), TEXT("head") },
+		{ TEXT("両目"), TEXT("eyes") },
+		{ TEXT("目"), TEXT("eye") },
+		{ TEXT("肩P"), TEXT("shoulderP") },
+		{ TEXT("肩"), TEXT("shoulder") },
+		{ TEXT("腕"), TEXT("arm") },
+		{ TEXT("腕捩"), TEXT("arm twist") },
+		{ TEXT("ひじ"), TEXT("elbow") },
+		{ TEXT("手捩"), TEXT("wrist twist") },
+		{ TEXT("手首"), TEXT("wrist") },
+		{ TEXT("親指０"), TEXT("thumb0") },
+		{ TEXT("親指１"), TEXT("thumb1") },
+		{ TEXT("親指２"), TEXT("thumb2") },
+		{ TEXT("人指１"), TEXT("fore1") },
+		{ TEXT("人指２"), TEXT("fore2") },
+		{ TEXT("人指３"), TEXT("fore3") },
+		{ TEXT("中指１"), TEXT("middle1") },
+		{ TEXT("中指２"), TEXT("middle2") },
+		{ TEXT("中指３"), TEXT("middle3") },
+		{ TEXT("薬指１"), TEXT("third1") },
+		{ TEXT("薬指２"), TEXT("third2") },
+		{ TEXT("薬指３"), TEXT("third3") },
+		{ TEXT("小指１"), TEXT("little1") },
+		{ TEXT("小指２"), TEXT("little2") },
+		{ TEXT("小指３"), TEXT("little3") },
+		{ TEXT("足"), TEXT("leg") },
+		{ TEXT("ひざ"), TEXT("knee") },
+		{ TEXT("足首"), TEXT("ankle") },
+		{ TEXT("つま先"), TEXT("toe") },
+		{ TEXT("足ＩＫ"), TEXT("leg IK") },
+		{ TEXT("つま先ＩＫ"), TEXT("toe IK") },
+		{ TEXT("足D"), TEXT("leg_D") },
+		{ TEXT("ひざD"), TEXT("knee_D") },
+		{ TEXT("足首D"), TEXT("ankle_D") },
+		{ TEXT("足先EX"), TEXT("toe_EX") },
+	};
+}
+
+UMmdBoneNameMapping::UMmdBoneNameMapping()
+	: LeftPrefix(TEXT("左"))
+	, RightPrefix(TEXT("右"))
+{
+	ResetBoneNames();
+}
+
+#if WITH_EDITOR
+void UMmdBoneNameMapping::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	MarkChanged();
+}
+#endif
+
+void UMmdBoneNameMapping::ResetBoneNames()
+{
+	BoneNames.Reset();
+
+	for (const auto& [MmdName, Name] : DefaultBoneNames)
+	{
+		BoneNames.Add(MmdName, FName(Name));
+	}
+
+	MarkChanged();
+}
+
+void UMmdBoneNameMapping::MarkChanged()
+{
+	++Revision;
+}
+
+FName UMmdBoneNameMapping::MapBoneName(const FString& TrackName) const
+{
+	if (const FName* Found = BoneNames.Find(TrackName))
+	{
+		return *Found;
+	}
+
+	if (bApplySideRules)
+	{
+		auto MapSide = [this, &TrackName](const FString& Prefix, const FString& Suffix, FName& OutName)
+		{
+			if (Prefix.IsEmpty() || !TrackName.StartsWith(Prefix, ESearchCase::CaseSensitive))
+			{
+				return false;
+			}
+
+			const FName* Found = BoneNames.Find(TrackName.RightChop(Prefix.Len()));
+			if (!Found)
+			{
+				return false;
+			}
+
+			OutName = FName(Found->ToString() + Suffix);
+			return true;
+		};
+
+		FName Name;
+		if (MapSide(LeftPrefix, LeftSuffix, Name) || MapSide(RightPrefix, RightSuffix, Name))
+		{
+			return Name;
+		}
+	}
+
+	return FName(TrackName);
+}
+
+FName UMmdBoneNameMapping::MapMorphName(const FString& TrackName) const
+{
+	if (const FName* Found = MorphNames.Find(TrackName))
+	{
+		return *Found;
+	}
+
+	return FName(TrackName);
+}
@@ -48,8 +48,38 @@ void AMmdCameraActor::Tick(float DeltaTime)
 
 	if (CameraSequence && !CameraSequence->Keys.IsEmpty())
 	{
-		UpdateCamera();
+		FUpdateInputs Inputs = GetUpdateInputs();
+		if (!LastUpdateInputs.IsSet() || !(LastUpdateInputs.GetValue() == Inputs))
+		{
+			UpdateCamera();
+			LastUpdateInputs = Inputs;
+		}
 	}
+	else
+	{
+		LastUpdateInputs.Reset();
+	}
+}
+
+AMmdCameraActor::FUpdateInputs AMmdCameraActor::GetUpdateInputs() const
+{
+	const FCameraFilmbackSettings& Filmback = CineCameraComponent->Filmback;
+
+	FUpdateInputs Inputs;
+	Inputs.Sequence = CameraSequence.Get();
+	Inputs.SequenceRevision = CameraSequence ? CameraSequence->GetRevision() : 0;
+	Inputs.Frame = Frame;
+	Inputs.LookAtOffset = LookAtOffset;
+	Inputs.LookAtScale = LookAtScale;
+	Inputs.RotationOffset = RotationOffset;
+	Inputs.DistanceScale = DistanceScale;
+	Inputs.FieldOfViewScale = FieldOfViewScale;
+	Inputs.Zoom = Zoom;
+	Inputs.OutputFrameRate = OutputFrameRate;
+	Inputs.bUseTemporalSampling = bUseTemporalSampling;
+	Inputs.SensorWidth = Filmback.SensorWidth;
+	Inputs.SensorHeight = Filmback.SensorHeight;
+	return Inputs;
 }
 
 void AMmdCameraActor::UpdateCamera()
@@ -61,7 +91,7 @@ void AMmdCameraActor::UpdateCamera()
 	FRotator Rotation;
 	float Distance;
 	float FieldOfView;
-	CameraSequence->CalcCameraProperty(FrameNo, Subframe, CutNo, LookAtLocation, Rotation, Distance, FieldOfView);
+	CameraSequence->CalcCameraProperty(FrameNo, Subframe, KeyCursor, CutNo, LookAtLocation, Rotation, Distance, FieldOfView);
 
 	LookAtLocation = LookAtScale * LookAtLocation + LookAtOffset;
 	Rotation += RotationOffset;
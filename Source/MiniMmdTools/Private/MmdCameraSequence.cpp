@@ -3,8 +3,156 @@
 
 #include "MmdCameraSequence.h"
 #include "MmdCommon.h"
+#include "poml.h"
+
+void UMmdCameraSequence::PostLoad()
+{
+	Super::PostLoad();
+
+	BindInterpolations();
+	Bake();
+}
+
+#if WITH_EDITOR
+void UMmdCameraSequence::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	BindInterpolations();
+	Bake();
+}
+#endif
+
+void UMmdCameraSequence::BindInterpolations()
+{
+	for (FMmdCameraKey& Key : Keys)
+	{
+		Key.LocationXInterpolation.Bind();
+		Key.LocationYInterpolation.Bind();
+		Key.LocationZInterpolation.Bind();
+		Key.RotationInterpolation.Bind();
+		Key.DistanceInterpolation.Bind();
+		Key.FieldOfViewInterpolation.Bind();
+	}
+}
+
+void UMmdCameraSequence::Bake()
+{
+	++Revision;
+
+	BakedSamples.Reset();
+	BakedFirstFrame = 0;
+
+	if (!bBakeFrames || Keys.IsEmpty())
+	{
+		BakedSamples.Empty();
+		return;
+	}
+
+	const int32 SamplesPerFrame = FMath::Clamp(BakeSamplesPerFrame, 1, 16);
+	const int32 FirstFrame = Keys[0].Frame;
+	const int64 FrameSpan = static_cast<int64>(Keys.Last().Frame) - FirstFrame;
+	const int64 NumSamples64 = FrameSpan * SamplesPerFrame + 1;
+
+	// Out-of-order or far apart keys would make the cache huge; such sequences keep evaluating the keys.
+	if (FrameSpan < 0 || NumSamples64 > MaxBakedSamples)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: cannot bake frames %d to %d, evaluating the keys instead."), *GetName(), FirstFrame, Keys.Last().Frame);
+		BakedSamples.Empty();
+		return;
+	}
+
+	const int32 NumSamples = static_cast<int32>(NumSamples64);
+	BakedSamples.SetNumUninitialized(NumSamples);
+
+	// The curves of all six channels are solved by calc_bezier_batch, a block of samples at a time.
+	constexpr int32 NumChannels = 6;
+	constexpr int32 BlockSize = 1024;
+
+	TArray<int32> KeyIndices;
+	TArray<float> Times, X1, X2, Y1, Y2, Alphas;
+	KeyIndices.Reserve(BlockSize);
+	for (TArray<float>* Array : { &Times, &X1, &X2, &Y1, &Y2, &Alphas })
+	{
+		Array->Reserve(BlockSize * NumChannels);
+	}
+
+	FMmdKeyCursor Cursor;
+	for (int32 First = 0; First < NumSamples; First += BlockSize)
+	{
+		const int32 Last = FMath::Min(First + BlockSize, NumSamples);
+
+		KeyIndices.Reset();
+		for (TArray<float>* Array : { &Times, &X1, &X2, &Y1, &Y2 })
+		{
+			Array->Reset();
+		}
+
+		for (int32 i = First; i < Last; ++i)
+		{
+			const int32 Frame = FirstFrame + i / SamplesPerFrame;
+			const float Subframe = static_cast<float>(i % SamplesPerFrame) / SamplesPerFrame;
+
+			const int32 Index1 = Cursor.Seek(Keys, Frame, &FMmdCameraKey::Frame);
+			KeyIndices.Add(Index1);
+
+			const auto [Key0, Key1] = GetKeysAround(Keys, Index1);
+			if (Key0.Cut != Key1.Cut || Key0.Frame == Key1.Frame)
+			{
+				continue;
+			}
+
+			const float Time = (Frame - Key0.Frame + Subframe) / (Key1.Frame - Key0.Frame);
+			for (const FMmdInterpolation* Interpolation : { &Key1.LocationXInterpolation, &Key1.LocationYInterpolation, &Key1.LocationZInterpolation,
+				&Key1.RotationInterpolation, &Key1.DistanceInterpolation, &Key1.FieldOfViewInterpolation })
+			{
+				Times.Add(Time);
+				X1.Add(Interpolation->X1);
+				X2.Add(Interpolation->X2);
+				Y1.Add(Interpolation->Y1);
+				Y2.Add(Interpolation->Y2);
+			}
+		}
+
+		Alphas.SetNumUninitialized(Times.Num(), EAllowShrinking::No);
+		poml::calc_bezier_batch(Times.GetData(), X1.GetData(), X2.GetData(), Y1.GetData(), Y2.GetData(), Alphas.GetData(), Times.Num());
+
+		const float* Alpha = Alphas.GetData();
+		for (int32 i = First; i < Last; ++i)
+		{
+			const auto [Key0, Key1] = GetKeysAround(Keys, KeyIndices[i - First]);
+			FMmdCameraSample& Sample = BakedSamples[i];
+
+			Sample.Cut = Key0.Cut;
+			if (Key0.Cut != Key1.Cut || Key0.Frame == Key1.Frame)
+			{
+				Sample.Location = Key0.Location;
+				Sample.Rotation = Key0.Rotation;
+				Sample.Distance = Key0.Distance;
+				Sample.FieldOfView = Key0.FieldOfView;
+				continue;
+			}
+
+			Sample.Location.X = FMath::Lerp(Key0.Location.X, Key1.Location.X, Alpha[0]);
+			Sample.Location.Y = FMath::Lerp(Key0.Location.Y, Key1.Location.Y, Alpha[1]);
+			Sample.Location.Z = FMath::Lerp(Key0.Location.Z, Key1.Location.Z, Alpha[2]);
+			Sample.Rotation = FMath::Lerp(Key0.Rotation, Key1.Rotation, Alpha[3]);
+			Sample.Distance = FMath::Lerp(Key0.Distance, Key1.Distance, Alpha[4]);
+			Sample.FieldOfView = FMath::Lerp(Key0.FieldOfView, Key1.FieldOfView, Alpha[5]);
+			Alpha += NumChannels;
+		}
+	}
+
+	BakedFirstFrame = FirstFrame;
+}
 
 void UMmdCameraSequence::CalcCameraProperty(int32 Frame, float Subframe, int32& OutCutNo, FVector& OutLocation, FRotator& OutRotation, float& OutDistance, float& OutFieldOfView) const
+{
+	FMmdKeyCursor Cursor;
+	CalcCameraProperty(Frame, Subframe, Cursor, OutCutNo, OutLocation, OutRotation, OutDistance, OutFieldOfView);
+}
+
+void UMmdCameraSequence::CalcCameraProperty(int32 Frame, float Subframe, FMmdKeyCursor& Cursor, int32& OutCutNo, FVector& OutLocation, FRotator& OutRotation, float& OutDistance, float& OutFieldOfView) const
 {
 	if (Keys.IsEmpty()) 
 	{
@@ -15,26 +163,70 @@ void UMmdCameraSequence::CalcCameraProperty(int32 Frame, float Subframe, int32&
 		return;
 	}
 
-	auto [Key0, Key1] = FindKeyByFrame(Keys, Frame);
+	FMmdCameraSample Sample;
+	if (IsBaked())
+	{
+		SampleBaked(Frame, Subframe, Sample);
+	}
+	else
+	{
+		EvaluateKeys(Frame, Subframe, Cursor, Sample);
+	}
+
+	OutCutNo = Sample.Cut;
+	OutLocation = Sample.Location;
+	OutRotation = FRotator(Sample.Rotation.X, Sample.Rotation.Y, Sample.Rotation.Z);
+	OutDistance = Sample.Distance;
+	OutFieldOfView = Sample.FieldOfView;
+}
+
+void UMmdCameraSequence::EvaluateKeys(int32 Frame, float Subframe, FMmdKeyCursor& Cursor, FMmdCameraSample& OutSample) const
+{
+	auto [Key0, Key1] = Cursor.FindKeyByFrame(Keys, Frame);
 	if (Key0.Cut != Key1.Cut || Key0.Frame == Key1.Frame)
 	{
-		OutCutNo = Key0.Cut;
-		OutLocation = Key0.Location;
-		FVector Rotation = Key0.Rotation;
-		OutRotation = FRotator(Rotation.X, Rotation.Y, Rotation.Z);
-		OutDistance = Key0.Distance;
-		OutFieldOfView = Key0.FieldOfView;
+		OutSample.Cut = Key0.Cut;
+		OutSample.Location = Key0.Location;
+		OutSample.Rotation = Key0.Rotation;
+		OutSample.Distance = Key0.Distance;
+		OutSample.FieldOfView = Key0.FieldOfView;
 	}
 	else
 	{
 		const float Time = (Frame - Key0.Frame + Subframe) / (Key1.Frame - Key0.Frame);
-		OutCutNo = Key0.Cut;
-		OutLocation.X = Key1.LocationXInterpolation.Interp(Key0.Location.X, Key1.Location.X, Time);
-		OutLocation.Y = Key1.LocationYInterpolation.Interp(Key0.Location.Y, Key1.Location.Y, Time);
-		OutLocation.Z = Key1.LocationZInterpolation.Interp(Key0.Location.Z, Key1.Location.Z, Time);
-		FVector Rotation = Key1.RotationInterpolation.Interp(Key0.Rotation, Key1.Rotation, Time);
-		OutRotation = FRotator(Rotation.X, Rotation.Y, Rotation.Z);
-		OutDistance = Key1.DistanceInterpolation.Interp(Key0.Distance, Key1.Distance, Time);
-		OutFieldOfView = Key1.FieldOfViewInterpolation.Interp(Key0.FieldOfView, Key1.FieldOfView, Time);
+		OutSample.Cut = Key0.Cut;
+		OutSample.Location.X = Key1.LocationXInterpolation.Interp(Key0.Location.X, Key1.Location.X, Time);
+		OutSample.Location.Y = Key1.LocationYInterpolation.Interp(Key0.Location.Y, Key1.Location.Y, Time);
+		OutSample.Location.Z = Key1.LocationZInterpolation.Interp(Key0.Location.Z, Key1.Location.Z, Time);
+		OutSample.Rotation = Key1.RotationInterpolation.Interp(Key0.Rotation, Key1.Rotation, Time);
+		OutSample.Distance = Key1.DistanceInterpolation.Interp(Key0.Distance, Key1.Distance, Time);
+		OutSample.FieldOfView = Key1.FieldOfViewInterpolation.Interp(Key0.FieldOfView, Key1.FieldOfView, Time);
+	}
+}
+
+void UMmdCameraSequence::SampleBaked(int32 Frame, float Subframe, FMmdCameraSample& OutSample) const
+{
+	const int32 SamplesPerFrame = FMath::Clamp(BakeSamplesPerFrame, 1, 16);
+	const int32 LastIndex = BakedSamples.Num() - 1;
+
+	const float Position = (static_cast<float>(Frame - BakedFirstFrame) + Subframe) * SamplesPerFrame;
+	const int32 Index0 = FMath::Clamp(FMath::FloorToInt32(Position), 0, LastIndex);
+	const int32 Index1 = FMath::Min(Index0 + 1, LastIndex);
+	const float Alpha = FMath::Clamp(Position - static_cast<float>(Index0), 0.f, 1.f);
+
+	const FMmdCameraSample& Sample0 = BakedSamples[Index0];
+	const FMmdCameraSample& Sample1 = BakedSamples[Index1];
+
+	// Never blend across a cut.
+	if (Sample0.Cut != Sample1.Cut || Index0 == Index1)
+	{
+		OutSample = Sample0;
+		return;
 	}
+
+	OutSample.Cut = Sample0.Cut;
+	OutSample.Location = FMath::Lerp(Sample0.Location, Sample1.Location, Alpha);
+	OutSample.Rotation = FMath::Lerp(Sample0.Rotation, Sample1.Rotation, Alpha);
+	OutSample.Distance = FMath::Lerp(Sample0.Distance, Sample1.Distance, Alpha);
+	OutSample.FieldOfView = FMath::Lerp(Sample0.FieldOfView, Sample1.FieldOfView, Alpha);
 }
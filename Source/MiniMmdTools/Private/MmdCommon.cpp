@@ -1,9 +1,84 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "MmdCommon.h"
+#include "Misc/ScopeRWLock.h"
 #include "poml.h"
 
+struct FMmdBezierTable : poml::BezierTable<128>
+{
+	using poml::BezierTable<128>::BezierTable;
+};
+
+namespace
+{
+	FRWLock BezierTableLock;
+	TMap<uint32, TUniquePtr<FMmdBezierTable>> BezierTables;
+
+	bool QuantizeControlPoint(float Value, uint32& OutValue)
+	{
+		const int32 Quantized = FMath::RoundToInt32(Value * 127.f);
+		if (Quantized < 0 || Quantized > 127 || !FMath::IsNearlyEqual(static_cast<float>(Quantized) / 127.f, Value))
+		{
+			return false;
+		}
+
+		OutValue = static_cast<uint32>(Quantized);
+		return true;
+	}
+}
+
+void FMmdInterpolation::Bind()
+{
+	Table = nullptr;
+
+	// Only curves on the VMD grid (0..127) are interned.
+	uint32 QX1, QY1, QX2, QY2;
+	if (!QuantizeControlPoint(X1, QX1) || !QuantizeControlPoint(Y1, QY1) || !QuantizeControlPoint(X2, QX2) || !QuantizeControlPoint(Y2, QY2))
+	{
+		return;
+	}
+
+	const uint32 Key = QX1 | (QX2 << 7) | (QY1 << 14) | (QY2 << 21);
+	{
+		FReadScopeLock ReadLock(BezierTableLock);
+		if (const TUniquePtr<FMmdBezierTable>* Found = BezierTables.Find(Key))
+		{
+			Table = Found->Get();
+			return;
+		}
+	}
+
+	const float TX1 = static_cast<float>(QX1) / 127.f;
+	const float TY1 = static_cast<float>(QY1) / 127.f;
+	const float TX2 = static_cast<float>(QX2) / 127.f;
+	const float TY2 = static_cast<float>(QY2) / 127.f;
+
+	TUniquePtr<FMmdBezierTable> NewTable = MakeUnique<FMmdBezierTable>(TX1, TX2, TY1, TY2);
+	if (!NewTable->is_accurate(TX1, TX2, TY1, TY2))
+	{
+		NewTable.Reset(); // Remember the rejection so the curve is not validated again.
+	}
+
+	FWriteScopeLock WriteLock(BezierTableLock);
+	Table = BezierTables.FindOrAdd(Key, MoveTemp(NewTable)).Get();
+}
+
 float FMmdInterpolation::AlphaAt(float Time) const
+{
+	if (Table && Time >= 0.f && Time <= 1.f)
+	{
+		return (*Table)(Time);
+	}
+
+	return AlphaAtExact(Time);
+}
+
+float FMmdInterpolation::AlphaAtExact(float Time) const
 {
 	return poml::calc_bezier<8>(Time, X1, X2, Y1, Y2);
 }
+
+float FMmdInterpolation::MaxTableError() const
+{
+	return Table ? Table->max_error(X1, X2, Y1, Y2) : 0.f;
+}
@@ -23,11 +23,69 @@ struct MINIMMDTOOLS_API FMmdBoneKey
 
 	UPROPERTY(EditAnywhere)
 	FMmdInterpolation LocationXInterpolation;
+
+	UPROPERTY(EditAnywhere)
 	FMmdInterpolation LocationYInterpolation;
+
+	UPROPERTY(EditAnywhere)
 	FMmdInterpolation LocationZInterpolation;
+
+	UPROPERTY(EditAnywhere)
 	FMmdInterpolation RotationInterpolation;
 };
 
+// Quantized bone keys, about a fifth of the size of FMmdBoneKey.
+// Locations keep 1/65535 of the track range per axis and rotations about 1e-4 radians.
+USTRUCT(Category = "MiniMmdTools")
+struct MINIMMDTOOLS_API FMmdCompressedBoneKeys
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<int32> Frames;
+
+	// 3 per key, LocationMin + Value * LocationScale.
+	UPROPERTY()
+	TArray<uint16> Locations;
+
+	// 3 per key, the smallest three quaternion components. The index of the dropped one is in the top bits of the first two.
+	UPROPERTY()
+	TArray<uint16> Rotations;
+
+	// 4 per key, location x, y, z and rotation curves as indices into Curves.
+	UPROPERTY()
+	TArray<uint16> CurveIndices;
+
+	// 4 per unique curve of the track, x1, y1, x2 and y2 as in VMD.
+	UPROPERTY()
+	TArray<uint8> Curves;
+
+	UPROPERTY()
+	FVector3f LocationMin = FVector3f::ZeroVector;
+
+	UPROPERTY()
+	FVector3f LocationScale = FVector3f::ZeroVector;
+
+	// Curves decoded from Curves and bound to the shared tables by Bind().
+	TArray<FMmdInterpolation> BoundCurves;
+
+	int32 Num() const
+	{
+		return Frames.Num();
+	}
+
+	// Fails when the keys use more unique curves than an index can address.
+	bool Compress(const TArray<FMmdBoneKey>& Keys);
+
+	void Decompress(TArray<FMmdBoneKey>& OutKeys) const;
+
+	void Bind();
+
+	FVector GetLocation(int32 Index) const;
+
+	FQuat GetRotation(int32 Index) const;
+};
+
 USTRUCT(BlueprintType, Category = "MiniMmdTools")
 struct MINIMMDTOOLS_API FMmdBoneTrack
 {
@@ -38,6 +96,36 @@ struct MINIMMDTOOLS_API FMmdBoneTrack
 
 	UPROPERTY(EditAnywhere)
 	TArray<FMmdBoneKey> Keys;
+
+	// Replaces Keys while the owning sequence is compressed.
+	UPROPERTY()
+	FMmdCompressedBoneKeys CompressedKeys;
+
+	bool IsCompressed() const
+	{
+		return CompressedKeys.Num() > 0;
+	}
+
+	int32 GetNumKeys() const
+	{
+		return IsCompressed() ? CompressedKeys.Num() : Keys.Num();
+	}
+
+	// Frame of the last key. The track must have keys.
+	int32 GetLastFrame() const
+	{
+		return IsCompressed() ? CompressedKeys.Frames.Last() : Keys.Last().Frame;
+	}
+
+	// Moves Keys into CompressedKeys. Keeps Keys when they cannot be compressed.
+	bool Compress();
+
+	void Decompress();
+
+	// Replaces runs of keys by single keys with refitted interpolation curves, as long as every removed key
+	// is still reproduced within the tolerances when evaluated through FMmdInterpolation.
+	// Compressed tracks are left as they are. Returns the number of removed keys.
+	int32 ReduceKeys(float PositionTolerance, float AngleToleranceDegrees);
 };
 
 USTRUCT(BlueprintType, Category = "MiniMmdTools")
@@ -64,6 +152,10 @@ struct MINIMMDTOOLS_API FMmdMorphTrack
 	TArray<FMmdMorphKey> Keys;
 };
 
+class USkeleton;
+class USkeletalMesh;
+class UMmdBoneNameMapping;
+
 UCLASS(BlueprintType, Category = "MiniMmdTools")
 class MINIMMDTOOLS_API UMmdAnimationSequence : public UObject
 {
@@ -75,4 +167,78 @@ public:
 
 	UPROPERTY(EditAnywhere)
 	TArray<FMmdMorphTrack> MorphTracks;
+
+	// Store bone keys quantized. Sampling decodes them on the fly.
+	UPROPERTY(EditAnywhere)
+	bool bCompressBoneKeys = false;
+
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	void BindInterpolations();
+
+	// Converts the bone tracks to match bCompressBoneKeys. Decompressed keys keep the quantization error.
+	void UpdateBoneKeyCompression();
+
+	// Interns the track names and drops every cached binding. Must be called again after tracks are renamed, added or removed.
+	void CacheTrackNames();
+
+	FName GetBoneTrackName(int32 TrackIndex) const
+	{
+		return BoneTrackNames[TrackIndex];
+	}
+
+	FName GetMorphTrackName(int32 TrackIndex) const
+	{
+		return MorphTrackNames[TrackIndex];
+	}
+
+	// Reference skeleton bone index per bone track, INDEX_NONE for tracks without a bone.
+	// Track names are translated by Mapping if given. A bone is bound to the first track which maps to it.
+	// Resolved once per skeleton and mapping, and cached until the bone names or the mapping change.
+	TSharedRef<const TArray<int32>> GetBoneIndices(const USkeleton* Skeleton, const UMmdBoneNameMapping* Mapping = nullptr) const;
+
+	// Morph target index per morph track, INDEX_NONE for tracks without a morph target.
+	// Resolved once per mesh and mapping, and cached until the morph target names or the mapping change.
+	TSharedRef<const TArray<int32>> GetMorphTargetIndices(const USkeletalMesh* Mesh, const UMmdBoneNameMapping* Mapping = nullptr) const;
+
+	// Samples one bone track at a fractional frame. Tracks without keys yield the identity.
+	void SampleBoneTrack(int32 TrackIndex, float Frame, FTransform& OutTransform) const;
+
+	void SampleBoneTrack(int32 TrackIndex, float Frame, FMmdKeyCursor& Cursor, FTransform& OutTransform) const;
+
+	// Samples every bone track into OutPose, indexed like BoneTracks. Does not allocate.
+	// When bParallel is set, the tracks are distributed over the task graph.
+	void SampleBoneTracks(float Frame, TArrayView<FTransform> OutPose, bool bParallel = false) const;
+
+	// Same as above with one playback cursor per track, kept by the caller.
+	void SampleBoneTracks(float Frame, TArrayView<FMmdKeyCursor> Cursors, TArrayView<FTransform> OutPose, bool bParallel = false) const;
+
+	// Samples every bone track bound to the skeleton into OutBoneTransforms, indexed by reference skeleton bone.
+	// Bones without a track are left as they are.
+	void SampleBonePose(float Frame, const USkeleton* Skeleton, const UMmdBoneNameMapping* Mapping, TArrayView<FTransform> OutBoneTransforms, bool bParallel = false) const;
+
+	// Same as above with one playback cursor per track, kept by the caller.
+	void SampleBonePose(float Frame, const USkeleton* Skeleton, const UMmdBoneNameMapping* Mapping, TArrayView<FMmdKeyCursor> Cursors, TArrayView<FTransform> OutBoneTransforms, bool bParallel = false) const;
+
+private:
+	struct FTrackBinding
+	{
+		// Bone or morph target names of the target and revision of the mapping when the indices were resolved.
+		TArray<FName> TargetNames;
+		uint32 MappingRevision = 0;
+		TSharedRef<const TArray<int32>> Indices = MakeShared<const TArray<int32>>();
+	};
+
+	template<typename GetNameFunc, typename ResolveFunc>
+	TSharedRef<const TArray<int32>> FindOrAddBinding(const UObject* Target, int32 NumTargets, GetNameFunc&& GetTargetName, const UMmdBoneNameMapping* Mapping, ResolveFunc&& Resolve) const;
+
+	TArray<FName> BoneTrackNames;
+	TArray<FName> MorphTrackNames;
+
+	mutable FCriticalSection BindingLock;
+	mutable TMap<TPair<TObjectKey<UObject>, TObjectKey<UMmdBoneNameMapping>>, FTrackBinding> Bindings;
 };
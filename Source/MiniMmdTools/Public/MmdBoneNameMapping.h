@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "MmdBoneNameMapping.generated.h"
+
+// Translates MMD track names to the bone and morph target names of a converted skeleton,
+// e.g. one exported from Blender by MMD Tools and Send to Unreal.
+UCLASS(BlueprintType, Category = "MiniMmdTools")
+class MINIMMDTOOLS_API UMmdBoneNameMapping : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UMmdBoneNameMapping();
+
+	// Track name, or track name without the side prefix, to bone name. Starts with the MMD to MMD Tools dictionary.
+	// Call MarkChanged after editing this or any rule below from code.
+	UPROPERTY(EditAnywhere, Category = "Bones")
+	TMap<FString, FName> BoneNames;
+
+	// Track name to morph target name.
+	UPROPERTY(EditAnywhere, Category = "Morphs")
+	TMap<FString, FName> MorphNames;
+
+	// When set, a side prefix of a track name is moved to a suffix of the translated name, e.g. 左腕 to arm_L.
+	UPROPERTY(EditAnywhere, Category = "Sides")
+	bool bApplySideRules = true;
+
+	UPROPERTY(EditAnywhere, Category = "Sides", meta = (EditCondition = "bApplySideRules"))
+	FString LeftPrefix;
+
+	UPROPERTY(EditAnywhere, Category = "Sides", meta = (EditCondition = "bApplySideRules"))
+	FString RightPrefix;
+
+	UPROPERTY(EditAnywhere, Category = "Sides", meta = (EditCondition = "bApplySideRules"))
+	FString LeftSuffix = TEXT("_L");
+
+	UPROPERTY(EditAnywhere, Category = "Sides", meta = (EditCondition = "bApplySideRules"))
+	FString RightSuffix = TEXT("_R");
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	// Replaces BoneNames with the built-in dictionary.
+	UFUNCTION(CallInEditor, Category = "Bones")
+	void ResetBoneNames();
+
+	// Translated bone name, or the track name itself when no rule applies.
+	FName MapBoneName(const FString& TrackName) const;
+
+	// Translated morph target name, or the track name itself when no rule applies.
+	FName MapMorphName(const FString& TrackName) const;
+
+	// Invalidates the bindings cached against this mapping. Editor edits call it already;
+	// code that changes the names or the side rules directly must call it afterwards.
+	UFUNCTION(BlueprintCallable, Category = "MiniMmdTools")
+	void MarkChanged();
+
+	// Changes whenever the rules are edited, so that cached bindings can be validated.
+	uint32 GetRevision() const
+	{
+		return Revision;
+	}
+
+private:
+	uint32 Revision = 0;
+};
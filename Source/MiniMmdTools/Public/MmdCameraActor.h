@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Camera/CameraActor.h"
+#include "MmdCommon.h"
 #include "MmdCameraActor.generated.h"
 
 /**
@@ -57,5 +58,31 @@ public:
 private:
 	class UCineCameraComponent* CineCameraComponent;
 
+	FMmdKeyCursor KeyCursor;
+
+	// Inputs of the last UpdateCamera. Ticks where none of them changed skip evaluation.
+	struct FUpdateInputs
+	{
+		const class UMmdCameraSequence* Sequence = nullptr;
+		uint32 SequenceRevision = 0;
+		float Frame = 0.f;
+		FVector LookAtOffset = FVector::ZeroVector;
+		FVector LookAtScale = FVector::ZeroVector;
+		FRotator RotationOffset = FRotator::ZeroRotator;
+		float DistanceScale = 0.f;
+		float FieldOfViewScale = 0.f;
+		float Zoom = 0.f;
+		float OutputFrameRate = 0.f;
+		bool bUseTemporalSampling = false;
+		float SensorWidth = 0.f;
+		float SensorHeight = 0.f;
+
+		bool operator==(const FUpdateInputs& Other) const = default;
+	};
+
+	TOptional<FUpdateInputs> LastUpdateInputs;
+
+	FUpdateInputs GetUpdateInputs() const;
+
 	void UpdateCamera();
 };
@@ -49,6 +49,16 @@ struct MINIMMDTOOLS_API FMmdCameraKey
 	FMmdInterpolation FieldOfViewInterpolation;
 };
 
+// Camera property at one point in time, as stored by the baked cache.
+struct FMmdCameraSample
+{
+	int32 Cut = 0;
+	FVector Location = FVector::ZeroVector;
+	FVector Rotation = FVector::ZeroVector;
+	float Distance = 0.f;
+	float FieldOfView = 90.f;
+};
+
 UCLASS(Category = "MiniMmdTools")
 class MINIMMDTOOLS_API UMmdCameraSequence : public UObject
 {
@@ -61,5 +71,52 @@ public:
 	UPROPERTY(EditAnywhere)
 	int32 FrameOffset = 0;
 
+	// Evaluate the keys once into a dense per-frame cache, so that sampling is an indexed read and a lerp.
+	UPROPERTY(EditAnywhere)
+	bool bBakeFrames = false;
+
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bBakeFrames", ClampMin = "1", ClampMax = "16"))
+	int32 BakeSamplesPerFrame = 1;
+
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	void BindInterpolations();
+
+	// Rebuilds the baked cache, or releases it when bBakeFrames is off.
+	// The cache is evaluated with the exact curves rather than the bound sample tables.
+	void Bake();
+
+	bool IsBaked() const
+	{
+		return !BakedSamples.IsEmpty();
+	}
+
+	// Changes whenever the keys or the cache are rebuilt.
+	uint32 GetRevision() const
+	{
+		return Revision;
+	}
+
 	void CalcCameraProperty(int32 Frame, float Subframe, int32& OutCutNo, FVector& OutLocation, FRotator& OutRotation, float& OutDistance, float& OutFieldOfView) const;
+
+	// Same as above, locating the keys with a playback cursor kept by the caller.
+	void CalcCameraProperty(int32 Frame, float Subframe, FMmdKeyCursor& Cursor, int32& OutCutNo, FVector& OutLocation, FRotator& OutRotation, float& OutDistance, float& OutFieldOfView) const;
+
+private:
+	// Upper bound of the baked cache in samples, about 9 hours of frames at 30 fps and one sample per frame.
+	static constexpr int64 MaxBakedSamples = 1 << 20;
+
+	TArray<FMmdCameraSample> BakedSamples;
+
+	int32 BakedFirstFrame = 0;
+
+	uint32 Revision = 0;
+
+	void EvaluateKeys(int32 Frame, float Subframe, FMmdKeyCursor& Cursor, FMmdCameraSample& OutSample) const;
+
+	void SampleBaked(int32 Frame, float Subframe, FMmdCameraSample& OutSample) const;
 };
@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "MmdCommon.generated.h"
 
+struct FMmdBezierTable;
+
 USTRUCT(Category = "MiniMmdTools")
 struct MINIMMDTOOLS_API FMmdInterpolation
 {
@@ -22,8 +24,24 @@ struct MINIMMDTOOLS_API FMmdInterpolation
 	UPROPERTY(EditAnywhere)
 	float Y2 = 1.0f;
 
+	// Shared sample table interned by Bind(). Curves without a table are evaluated by Newton iteration.
+	const FMmdBezierTable* Table = nullptr;
+
+	// Binds the shared table for the control points. Must be called again after they are changed.
+	void Bind();
+
+	bool IsBound() const
+	{
+		return Table != nullptr;
+	}
+
 	float AlphaAt(float Time) const;
 
+	float AlphaAtExact(float Time) const;
+
+	// Largest deviation of the bound table from AlphaAtExact over the samples Bind validated, 0 if unbound.
+	float MaxTableError() const;
+
 	template<typename T>
 	T Interp(const T& A, const T& B, float Time) const
 	{
@@ -40,9 +58,8 @@ struct MINIMMDTOOLS_API FMmdInterpolation
 };
 
 template<typename T>
-TPair<const T&, const T&> FindKeyByFrame(const TArray<T>& Keys, int32 Frame)
+TPair<const T&, const T&> GetKeysAround(const TArray<T>& Keys, int32 Index1)
 {
-	int32 Index1 = Algo::UpperBoundBy(Keys, Frame, &T::Frame);
 	int32 Index0 = Index1 - 1;
 
 	return {
@@ -50,3 +67,60 @@ TPair<const T&, const T&> FindKeyByFrame(const TArray<T>& Keys, int32 Frame)
 		Keys[FMath::Clamp(Index1, 0, Keys.Num() - 1)],
 	};
 }
+
+template<typename T>
+TPair<const T&, const T&> FindKeyByFrame(const TArray<T>& Keys, int32 Frame)
+{
+	return GetKeysAround(Keys, Algo::UpperBoundBy(Keys, Frame, &T::Frame));
+}
+
+// Playback cursor which remembers the last key segment, so that monotonic playback finds keys in O(1).
+// Seeks fall back to binary search. The result is the same as FindKeyByFrame.
+struct FMmdKeyCursor
+{
+	// Index of the first key after the frame of the last lookup.
+	int32 Index = 0;
+
+	void Reset()
+	{
+		Index = 0;
+	}
+
+	template<typename T>
+	TPair<const T&, const T&> FindKeyByFrame(const TArray<T>& Keys, int32 Frame)
+	{
+		return GetKeysAround(Keys, Seek(Keys, Frame, &T::Frame));
+	}
+
+	// Moves the cursor to the segment containing Frame and returns the index of the first key after it.
+	// Projection maps an element to its frame.
+	template<typename T, typename ProjectionType>
+	int32 Seek(const TArray<T>& Keys, int32 Frame, ProjectionType Projection)
+	{
+		const int32 Num = Keys.Num();
+
+		auto IsSegment = [&Keys, &Projection, Num, Frame](int32 Index1)
+		{
+			return (Index1 == 0 || Invoke(Projection, Keys[Index1 - 1]) <= Frame) && (Index1 == Num || Frame < Invoke(Projection, Keys[Index1]));
+		};
+
+		Index = FMath::Clamp(Index, 0, Num);
+		if (!IsSegment(Index))
+		{
+			if (Index < Num && IsSegment(Index + 1))
+			{
+				++Index;
+			}
+			else if (Index > 0 && IsSegment(Index - 1))
+			{
+				--Index;
+			}
+			else
+			{
+				Index = Algo::UpperBoundBy(Keys, Frame, Projection);
+			}
+		}
+
+		return Index;
+	}
+};
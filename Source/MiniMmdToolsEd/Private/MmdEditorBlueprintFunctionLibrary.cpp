@@ -2,13 +2,78 @@
 
 
 #include "MmdEditorBlueprintFunctionLibrary.h"
+#include "Animation/AnimSequence.h"
+#include "Animation/MorphTarget.h"
+#include "Async/ParallelFor.h"
 #include "MmdAnimationSequence.h"
 
-void UMmdEditorBlueprintFunctionLibrary::ApplyMorph(UAnimSequence* AnimSequence, const UMmdAnimationSequence* MmdAnimationSequence, int32 FrameOffset)
+#define LOCTEXT_NAMESPACE "MmdEditorBlueprintFunctionLibrary"
+
+namespace
+{
+	// Ramer-Douglas-Peucker over linearly interpolated keys, measuring the error along the value axis.
+	// Keeps the first and last key. Stack and Keep are scratch buffers reused between calls.
+	int32 ReduceLinearKeys(TArray<FRichCurveKey>& Keys, float Tolerance, TArray<TPair<int32, int32>>& Stack, TBitArray<>& Keep)
+	{
+		const int32 NumKeys = Keys.Num();
+		if (NumKeys <= 2)
+		{
+			return 0;
+		}
+
+		Keep.Init(false, NumKeys);
+		Keep[0] = true;
+		Keep[NumKeys - 1] = true;
+
+		Stack.Reset();
+		Stack.Add({ 0, NumKeys - 1 });
+
+		while (!Stack.IsEmpty())
+		{
+			const auto [First, Last] = Stack.Pop(EAllowShrinking::No);
+			const FRichCurveKey& Key0 = Keys[First];
+			const FRichCurveKey& Key1 = Keys[Last];
+
+			float MaxError = 0.f;
+			int32 MaxIndex = INDEX_NONE;
+			for (int32 i = First + 1; i < Last; ++i)
+			{
+				const float Alpha = Key1.Time > Key0.Time ? (Keys[i].Time - Key0.Time) / (Key1.Time - Key0.Time) : 0.f;
+				const float Error = FMath::Abs(Keys[i].Value - FMath::Lerp(Key0.Value, Key1.Value, Alpha));
+				if (Error > MaxError)
+				{
+					MaxError = Error;
+					MaxIndex = i;
+				}
+			}
+
+			if (MaxIndex != INDEX_NONE && MaxError > Tolerance)
+			{
+				Keep[MaxIndex] = true;
+				Stack.Add({ First, MaxIndex });
+				Stack.Add({ MaxIndex, Last });
+			}
+		}
+
+		int32 NumKept = 0;
+		for (int32 i = 0; i < NumKeys; ++i)
+		{
+			if (Keep[i])
+			{
+				Keys[NumKept++] = Keys[i];
+			}
+		}
+
+		Keys.SetNum(NumKept, EAllowShrinking::No);
+		return NumKeys - NumKept;
+	}
+}
+
+int32 UMmdEditorBlueprintFunctionLibrary::ApplyMorph(UAnimSequence* AnimSequence, const UMmdAnimationSequence* MmdAnimationSequence, int32 FrameOffset, bool bShouldTransact, float ReductionTolerance, const UMmdBoneNameMapping* NameMapping)
 {
 	if (!AnimSequence || !MmdAnimationSequence)
 	{
-		return;
+		return 0;
 	}
 
 	USkeletalMesh* Mesh = AnimSequence->GetPreviewMesh();
@@ -25,31 +90,164 @@ void UMmdEditorBlueprintFunctionLibrary::ApplyMorph(UAnimSequence* AnimSequence,
 	IAnimationDataController& Controller = AnimSequence->GetController();
 	check(Controller.GetModel() != nullptr);
 
+	int32 MaxNumKeys = 0;
 	for (auto& Track : MmdAnimationSequence->MorphTracks)
 	{
-		FName Name = FName(Track.Name);
+		MaxNumKeys = FMath::Max(MaxNumKeys, Track.Keys.Num());
+	}
+
+	TArray<FRichCurveKey> CurveKeys;
+	CurveKeys.Reserve(MaxNumKeys);
 
-		if (!Mesh->FindMorphTarget(Name))
+	TArray<TPair<int32, int32>> ReductionStack;
+	TBitArray<> ReductionKeep;
+	int32 NumRemovedKeys = 0;
+
+	// One bracket, so that the model notifies and compresses once for all curves.
+	Controller.OpenBracket(LOCTEXT("ApplyMorph", "Apply MMD Morph"), bShouldTransact);
+
+	const TSharedRef<const TArray<int32>> MorphTargetIndices = MmdAnimationSequence->GetMorphTargetIndices(Mesh, NameMapping);
+
+	for (int32 TrackIndex = 0; TrackIndex < MmdAnimationSequence->MorphTracks.Num(); ++TrackIndex)
+	{
+		const int32 MorphTargetIndex = (*MorphTargetIndices)[TrackIndex];
+		if (MorphTargetIndex == INDEX_NONE)
 		{
 			continue;
 		}
 
+		const FMmdMorphTrack& Track = MmdAnimationSequence->MorphTracks[TrackIndex];
+		const FName Name = Mesh->GetMorphTargets()[MorphTargetIndex]->GetFName();
+
 		FAnimationCurveIdentifier CurveId = FAnimationCurveIdentifier(Name, ERawCurveTrackTypes::RCT_Float);
 		if (!Controller.GetModel()->FindCurve(CurveId))
 		{
-			if (!Controller.AddCurve(CurveId))
+			if (!Controller.AddCurve(CurveId, AACF_Editable, bShouldTransact))
 			{
 				continue;
 			}
 		}
 		
-		TArray<FRichCurveKey> CurveKeys;
+		CurveKeys.Reset();
 		for (auto& Key : Track.Keys)
 		{
 			float Time = static_cast<float>(Key.Frame + FrameOffset) / 30.f;
 			CurveKeys.Add(FRichCurveKey(Time, Key.Value));
 		}
 
-		Controller.SetCurveKeys(CurveId, CurveKeys);
+		if (ReductionTolerance > 0.f)
+		{
+			NumRemovedKeys += ReduceLinearKeys(CurveKeys, ReductionTolerance, ReductionStack, ReductionKeep);
+		}
+
+		Controller.SetCurveKeys(CurveId, CurveKeys, bShouldTransact);
 	}
+
+	Controller.CloseBracket(bShouldTransact);
+
+	return NumRemovedKeys;
 }
+
+void UMmdEditorBlueprintFunctionLibrary::ApplyBoneMotion(UAnimSequence* AnimSequence, const UMmdAnimationSequence* MmdAnimationSequence, int32 FrameOffset, bool bShouldTransact, const UMmdBoneNameMapping* NameMapping)
+{
+	if (!AnimSequence || !MmdAnimationSequence)
+	{
+		return;
+	}
+
+	const USkeleton* Skeleton = AnimSequence->GetSkeleton();
+	check(Skeleton != nullptr);
+
+	const FReferenceSkeleton& RefSkeleton = Skeleton->GetReferenceSkeleton();
+	const TArray<FTransform>& RefPose = RefSkeleton.GetRefBonePose();
+
+	IAnimationDataController& Controller = AnimSequence->GetController();
+	const IAnimationDataModel* Model = Controller.GetModel();
+	check(Model != nullptr);
+
+	struct FBoneMotion
+	{
+		int32 TrackIndex;
+		int32 BoneIndex;
+		TArray<FVector3f> Positions;
+		TArray<FQuat4f> Rotations;
+		TArray<FVector3f> Scales;
+	};
+
+	TArray<FBoneMotion> Motions;
+	Motions.Reserve(MmdAnimationSequence->BoneTracks.Num());
+
+	const TSharedRef<const TArray<int32>> BoneIndices = MmdAnimationSequence->GetBoneIndices(Skeleton, NameMapping);
+
+	int32 LastFrame = 0;
+	for (int32 TrackIndex = 0; TrackIndex < MmdAnimationSequence->BoneTracks.Num(); ++TrackIndex)
+	{
+		const FMmdBoneTrack& Track = MmdAnimationSequence->BoneTracks[TrackIndex];
+
+		const int32 BoneIndex = (*BoneIndices)[TrackIndex];
+		if (BoneIndex == INDEX_NONE || Track.GetNumKeys() == 0)
+		{
+			continue;
+		}
+
+		Motions.Add({ TrackIndex, BoneIndex });
+		LastFrame = FMath::Max(LastFrame, Track.GetLastFrame() + FrameOffset);
+	}
+
+	if (Motions.IsEmpty())
+	{
+		return;
+	}
+
+	const FFrameRate FrameRate = Model->GetFrameRate();
+	const int32 NumFrames = FMath::Max(Model->GetNumberOfFrames(), FrameRate.AsFrameTime(LastFrame / 30.0).CeilToFrame().Value);
+	const int32 NumKeys = NumFrames + 1;
+
+	ParallelFor(Motions.Num(), [&](int32 MotionIndex)
+		{
+			FBoneMotion& Motion = Motions[MotionIndex];
+			Motion.Positions.SetNumUninitialized(NumKeys);
+			Motion.Rotations.SetNumUninitialized(NumKeys);
+			Motion.Scales.SetNumUninitialized(NumKeys);
+
+			const FTransform& Ref = RefPose[Motion.BoneIndex];
+
+			FMmdKeyCursor Cursor;
+			for (int32 KeyIndex = 0; KeyIndex < NumKeys; ++KeyIndex)
+			{
+				const float Frame = static_cast<float>(FrameRate.AsSeconds(KeyIndex) * 30.0) - FrameOffset;
+
+				FTransform Delta;
+				MmdAnimationSequence->SampleBoneTrack(Motion.TrackIndex, Frame, Cursor, Delta);
+
+				// The track is relative to the reference pose, so its translation is rotated into the parent space.
+				const FTransform Local = Delta * Ref;
+
+				Motion.Positions[KeyIndex] = FVector3f(Local.GetLocation());
+				Motion.Rotations[KeyIndex] = FQuat4f(Local.GetRotation());
+				Motion.Scales[KeyIndex] = FVector3f(Local.GetScale3D());
+			}
+		});
+
+	Controller.OpenBracket(LOCTEXT("ApplyBoneMotion", "Apply MMD Bone Motion"), bShouldTransact);
+
+	if (NumFrames != Model->GetNumberOfFrames())
+	{
+		Controller.SetNumberOfFrames(FFrameNumber(NumFrames), bShouldTransact);
+	}
+
+	for (const FBoneMotion& Motion : Motions)
+	{
+		const FName BoneName = RefSkeleton.GetBoneName(Motion.BoneIndex);
+		if (!Model->IsValidBoneTrackName(BoneName))
+		{
+			Controller.AddBoneCurve(BoneName, bShouldTransact);
+		}
+
+		Controller.SetBoneTrackKeys(BoneName, Motion.Positions, Motion.Rotations, Motion.Scales, bShouldTransact);
+	}
+
+	Controller.CloseBracket(bShouldTransact);
+}
+
+#undef LOCTEXT_NAMESPACE
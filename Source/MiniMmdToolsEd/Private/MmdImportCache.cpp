@@ -0,0 +1,371 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MmdImportCache.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Hash/CityHash.h"
+#include "Misc/FileHelper.h"
+
+namespace
+{
+	constexpr uint32 CacheMagic = 0x43444D4D; // "MMDC"
+
+	// Bump whenever a record layout, the conversion or the key reduction changes.
+	constexpr uint32 CacheVersion = 1;
+
+	// Sections follow the header in this order: bone track entries, morph track entries, bone keys, camera keys,
+	// morph keys and the UTF-8 name blob. Every record size is a multiple of 8, so all sections stay aligned.
+	struct FCacheHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint64 Key;
+		uint32 NumBoneTracks;
+		uint32 NumMorphTracks;
+		uint32 NumBoneKeys;
+		uint32 NumMorphKeys;
+		uint32 NumCameraKeys;
+		uint32 NameBytes;
+	};
+
+	struct FCachedTrack
+	{
+		uint32 NameOffset;
+		uint32 NameLength;
+		uint32 FirstKey;
+		uint32 NumKeys;
+	};
+
+	struct FCachedInterpolation
+	{
+		float X1;
+		float Y1;
+		float X2;
+		float Y2;
+	};
+
+	struct FCachedBoneKey
+	{
+		double Location[3];
+		double Rotation[4];
+		int32 Frame;
+		int32 Padding;
+		FCachedInterpolation Interpolations[4]; // location x, y, z, rotation
+	};
+
+	struct FCachedMorphKey
+	{
+		int32 Frame;
+		float Value;
+	};
+
+	struct FCachedCameraKey
+	{
+		double Location[3];
+		double Rotation[3];
+		int32 Frame;
+		int32 Cut;
+		float Distance;
+		float FieldOfView;
+		FCachedInterpolation Interpolations[6]; // location x, y, z, rotation, distance, field of view
+	};
+
+	static_assert(sizeof(FCacheHeader) == 40);
+	static_assert(sizeof(FCachedTrack) == 16);
+	static_assert(sizeof(FCachedBoneKey) == 128);
+	static_assert(sizeof(FCachedMorphKey) == 8);
+	static_assert(sizeof(FCachedCameraKey) == 160);
+
+	FCachedInterpolation ToCached(const FMmdInterpolation& Interpolation)
+	{
+		return { Interpolation.X1, Interpolation.Y1, Interpolation.X2, Interpolation.Y2 };
+	}
+
+	FMmdInterpolation FromCached(const FCachedInterpolation& Cached)
+	{
+		return FMmdInterpolation{ Cached.X1, Cached.Y1, Cached.X2, Cached.Y2 };
+	}
+
+	FCachedBoneKey ToCached(const FMmdBoneKey& Key)
+	{
+		return {
+			{ Key.Location.X, Key.Location.Y, Key.Location.Z },
+			{ Key.Rotation.X, Key.Rotation.Y, Key.Rotation.Z, Key.Rotation.W },
+			Key.Frame,
+			0,
+			{ ToCached(Key.LocationXInterpolation), ToCached(Key.LocationYInterpolation), ToCached(Key.LocationZInterpolation), ToCached(Key.RotationInterpolation) },
+		};
+	}
+
+	FMmdBoneKey FromCached(const FCachedBoneKey& Cached)
+	{
+		FMmdBoneKey Key;
+		Key.Frame = Cached.Frame;
+		Key.Location = FVector(Cached.Location[0], Cached.Location[1], Cached.Location[2]);
+		Key.Rotation = FQuat(Cached.Rotation[0], Cached.Rotation[1], Cached.Rotation[2], Cached.Rotation[3]);
+		Key.LocationXInterpolation = FromCached(Cached.Interpolations[0]);
+		Key.LocationYInterpolation = FromCached(Cached.Interpolations[1]);
+		Key.LocationZInterpolation = FromCached(Cached.Interpolations[2]);
+		Key.RotationInterpolation = FromCached(Cached.Interpolations[3]);
+		return Key;
+	}
+
+	FCachedMorphKey ToCached(const FMmdMorphKey& Key)
+	{
+		return { Key.Frame, Key.Value };
+	}
+
+	FMmdMorphKey FromCached(const FCachedMorphKey& Cached)
+	{
+		FMmdMorphKey Key;
+		Key.Frame = Cached.Frame;
+		Key.Value = Cached.Value;
+		return Key;
+	}
+
+	FCachedCameraKey ToCached(const FMmdCameraKey& Key)
+	{
+		return {
+			{ Key.Location.X, Key.Location.Y, Key.Location.Z },
+			{ Key.Rotation.X, Key.Rotation.Y, Key.Rotation.Z },
+			Key.Frame,
+			Key.Cut,
+			Key.Distance,
+			Key.FieldOfView,
+			{
+				ToCached(Key.LocationXInterpolation), ToCached(Key.LocationYInterpolation), ToCached(Key.LocationZInterpolation),
+				ToCached(Key.RotationInterpolation), ToCached(Key.DistanceInterpolation), ToCached(Key.FieldOfViewInterpolation),
+			},
+		};
+	}
+
+	FMmdCameraKey FromCached(const FCachedCameraKey& Cached)
+	{
+		FMmdCameraKey Key;
+		Key.Frame = Cached.Frame;
+		Key.Cut = Cached.Cut;
+		Key.Location = FVector(Cached.Location[0], Cached.Location[1], Cached.Location[2]);
+		Key.Rotation = FVector(Cached.Rotation[0], Cached.Rotation[1], Cached.Rotation[2]);
+		Key.Distance = Cached.Distance;
+		Key.FieldOfView = Cached.FieldOfView;
+		Key.LocationXInterpolation = FromCached(Cached.Interpolations[0]);
+		Key.LocationYInterpolation = FromCached(Cached.Interpolations[1]);
+		Key.LocationZInterpolation = FromCached(Cached.Interpolations[2]);
+		Key.RotationInterpolation = FromCached(Cached.Interpolations[3]);
+		Key.DistanceInterpolation = FromCached(Cached.Interpolations[4]);
+		Key.FieldOfViewInterpolation = FromCached(Cached.Interpolations[5]);
+		return Key;
+	}
+
+	// Section offsets computed from the header counts.
+	struct FCacheLayout
+	{
+		uint64 BoneTracks;
+		uint64 MorphTracks;
+		uint64 BoneKeys;
+		uint64 CameraKeys;
+		uint64 MorphKeys;
+		uint64 Names;
+		uint64 Size;
+
+		explicit FCacheLayout(const FCacheHeader& Header)
+		{
+			BoneTracks = sizeof(FCacheHeader);
+			MorphTracks = BoneTracks + uint64(Header.NumBoneTracks) * sizeof(FCachedTrack);
+			BoneKeys = MorphTracks + uint64(Header.NumMorphTracks) * sizeof(FCachedTrack);
+			CameraKeys = BoneKeys + uint64(Header.NumBoneKeys) * sizeof(FCachedBoneKey);
+			MorphKeys = CameraKeys + uint64(Header.NumCameraKeys) * sizeof(FCachedCameraKey);
+			Names = MorphKeys + uint64(Header.NumMorphKeys) * sizeof(FCachedMorphKey);
+			Size = Names + Header.NameBytes;
+		}
+	};
+
+	template<typename TTrack, typename TCachedKey>
+	bool ReadTracks(const uint8* Data, const FCacheHeader& Header, uint64 TrackOffset, uint32 NumTracks, uint64 KeyOffset, uint32 NumKeys, uint64 NameOffset, TArray<TTrack>& OutTracks)
+	{
+		const FCachedTrack* Tracks = reinterpret_cast<const FCachedTrack*>(Data + TrackOffset);
+		const TCachedKey* Keys = reinterpret_cast<const TCachedKey*>(Data + KeyOffset);
+		const ANSICHAR* Names = reinterpret_cast<const ANSICHAR*>(Data + NameOffset);
+
+		OutTracks.SetNum(NumTracks);
+
+		for (uint32 TrackIndex = 0; TrackIndex < NumTracks; ++TrackIndex)
+		{
+			const FCachedTrack& Cached = Tracks[TrackIndex];
+			if (uint64(Cached.NameOffset) + Cached.NameLength > Header.NameBytes || uint64(Cached.FirstKey) + Cached.NumKeys > NumKeys)
+			{
+				return false;
+			}
+
+			TTrack& Track = OutTracks[TrackIndex];
+
+			FUTF8ToTCHAR Name(Names + Cached.NameOffset, Cached.NameLength);
+			Track.Name = FString(Name.Length(), Name.Get());
+
+			Track.Keys.Reserve(Cached.NumKeys);
+			for (uint32 KeyIndex = 0; KeyIndex < Cached.NumKeys; ++KeyIndex)
+			{
+				Track.Keys.Add(FromCached(Keys[Cached.FirstKey + KeyIndex]));
+			}
+		}
+
+		return true;
+	}
+
+	template<typename TTrack, typename TCachedKey>
+	void WriteTracks(const TArray<TTrack>& Tracks, TArray<FCachedTrack>& OutTracks, TArray<TCachedKey>& OutKeys, TArray<ANSICHAR>& OutNames)
+	{
+		for (const TTrack& Track : Tracks)
+		{
+			FTCHARToUTF8 Name(*Track.Name);
+
+			FCachedTrack& Cached = OutTracks.AddDefaulted_GetRef();
+			Cached.NameOffset = OutNames.Num();
+			Cached.NameLength = Name.Length();
+			Cached.FirstKey = OutKeys.Num();
+			Cached.NumKeys = Track.Keys.Num();
+
+			OutNames.Append(Name.Get(), Name.Length());
+			for (const auto& Key : Track.Keys)
+			{
+				OutKeys.Add(ToCached(Key));
+			}
+		}
+	}
+
+	template<typename T>
+	void AppendSection(TArray64<uint8>& Out, const TArray<T>& Section)
+	{
+		Out.Append(reinterpret_cast<const uint8*>(Section.GetData()), Section.NumBytes());
+	}
+}
+
+FString MmdImportCache::GetCachePath(const FString& SourceFilename)
+{
+	return SourceFilename + TEXT(".mmdcache");
+}
+
+uint64 MmdImportCache::MakeKey(const uint8* Source, int64 SourceSize, uint64 OptionsHash)
+{
+	uint64 Key = CityHash64WithSeed(reinterpret_cast<const char*>(&SourceSize), sizeof(SourceSize), OptionsHash);
+
+	for (int64 Offset = 0; Offset < SourceSize; Offset += MAX_uint32)
+	{
+		const uint32 Length = static_cast<uint32>(FMath::Min<int64>(SourceSize - Offset, MAX_uint32));
+		Key = CityHash64WithSeed(reinterpret_cast<const char*>(Source + Offset), Length, Key);
+	}
+
+	return Key;
+}
+
+bool MmdImportCache::Load(const FString& CachePath, uint64 Key, FMmdImportData& OutData)
+{
+	TUniquePtr<IMappedFileHandle> Handle(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*CachePath));
+	TUniquePtr<IMappedFileRegion> Region;
+	TArray64<uint8> Buffer;
+
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+
+	if (Handle)
+	{
+		Region.Reset(Handle->MapRegion());
+	}
+
+	if (Region)
+	{
+		Data = Region->GetMappedPtr();
+		Size = Region->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(Buffer, *CachePath, FILEREAD_Silent))
+	{
+		Data = Buffer.GetData();
+		Size = Buffer.Num();
+	}
+	else
+	{
+		return false;
+	}
+
+	if (Size < static_cast<int64>(sizeof(FCacheHeader)))
+	{
+		return false;
+	}
+
+	const FCacheHeader& Header = *reinterpret_cast<const FCacheHeader*>(Data);
+	if (Header.Magic != CacheMagic || Header.Version != CacheVersion || Header.Key != Key)
+	{
+		return false;
+	}
+
+	const FCacheLayout Layout(Header);
+	if (Layout.Size != static_cast<uint64>(Size))
+	{
+		return false;
+	}
+
+	FMmdImportData Imported;
+
+	if (!ReadTracks<FMmdBoneTrack, FCachedBoneKey>(Data, Header, Layout.BoneTracks, Header.NumBoneTracks, Layout.BoneKeys, Header.NumBoneKeys, Layout.Names, Imported.BoneTracks))
+	{
+		return false;
+	}
+
+	if (!ReadTracks<FMmdMorphTrack, FCachedMorphKey>(Data, Header, Layout.MorphTracks, Header.NumMorphTracks, Layout.MorphKeys, Header.NumMorphKeys, Layout.Names, Imported.MorphTracks))
+	{
+		return false;
+	}
+
+	const FCachedCameraKey* CameraKeys = reinterpret_cast<const FCachedCameraKey*>(Data + Layout.CameraKeys);
+	Imported.CameraKeys.Reserve(Header.NumCameraKeys);
+	for (uint32 KeyIndex = 0; KeyIndex < Header.NumCameraKeys; ++KeyIndex)
+	{
+		Imported.CameraKeys.Add(FromCached(CameraKeys[KeyIndex]));
+	}
+
+	OutData = MoveTemp(Imported);
+	return true;
+}
+
+bool MmdImportCache::Save(const FString& CachePath, uint64 Key, const FMmdImportData& Data)
+{
+	TArray<FCachedTrack> BoneTracks;
+	TArray<FCachedTrack> MorphTracks;
+	TArray<FCachedBoneKey> BoneKeys;
+	TArray<FCachedMorphKey> MorphKeys;
+	TArray<FCachedCameraKey> CameraKeys;
+	TArray<ANSICHAR> Names;
+
+	WriteTracks(Data.BoneTracks, BoneTracks, BoneKeys, Names);
+	WriteTracks(Data.MorphTracks, MorphTracks, MorphKeys, Names);
+
+	CameraKeys.Reserve(Data.CameraKeys.Num());
+	for (const FMmdCameraKey& CameraKey : Data.CameraKeys)
+	{
+		CameraKeys.Add(ToCached(CameraKey));
+	}
+
+	FCacheHeader Header = {};
+	Header.Magic = CacheMagic;
+	Header.Version = CacheVersion;
+	Header.Key = Key;
+	Header.NumBoneTracks = BoneTracks.Num();
+	Header.NumMorphTracks = MorphTracks.Num();
+	Header.NumBoneKeys = BoneKeys.Num();
+	Header.NumMorphKeys = MorphKeys.Num();
+	Header.NumCameraKeys = CameraKeys.Num();
+	Header.NameBytes = Names.Num();
+
+	TArray64<uint8> Out;
+	Out.Reserve(FCacheLayout(Header).Size);
+	Out.Append(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+	AppendSection(Out, BoneTracks);
+	AppendSection(Out, MorphTracks);
+	AppendSection(Out, BoneKeys);
+	AppendSection(Out, CameraKeys);
+	AppendSection(Out, MorphKeys);
+	AppendSection(Out, Names);
+
+	return FFileHelper::SaveArrayToFile(Out, *CachePath);
+}
@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MmdAnimationSequence.h"
+#include "MmdCameraSequence.h"
+
+// Converted keys of one VMD file, ready to be moved into sequences.
+struct FMmdImportData
+{
+	TArray<FMmdBoneTrack> BoneTracks;
+	TArray<FMmdMorphTrack> MorphTracks;
+	TArray<FMmdCameraKey> CameraKeys;
+};
+
+// Binary cache of FMmdImportData stored next to the source file.
+// The file is a header followed by fixed-size POD records, so it is read by mapping it and copying the records out.
+// It is only used while its key matches the hash of the source bytes and the import options.
+namespace MmdImportCache
+{
+	FString GetCachePath(const FString& SourceFilename);
+
+	uint64 MakeKey(const uint8* Source, int64 SourceSize, uint64 OptionsHash);
+
+	bool Load(const FString& CachePath, uint64 Key, FMmdImportData& OutData);
+
+	bool Save(const FString& CachePath, uint64 Key, const FMmdImportData& Data);
+}
@@ -2,12 +2,11 @@
 
 
 #include "VmdFactory.h"
+#include "Async/ParallelFor.h"
+#include "Hash/CityHash.h"
 #include "MmdAnimationSequence.h"
 #include "MmdCameraSequence.h"
-
-#if PLATFORM_WINDOWS
-#include "Windows/WindowsHWrapper.h"
-#endif
+#include "MmdImportCache.h"
 
 #include "poml.h"
 
@@ -20,13 +19,8 @@ namespace
 
 	FString ShiftJisToString(const std::string& Str)
 	{
-		int Length = MultiByteToWideChar(CP_ACP, 0, Str.c_str(), -1, nullptr, 0);
-
-		TArray<wchar_t> Buff;
-		Buff.SetNum(Length + 1);
-		MultiByteToWideChar(CP_ACP, 0, Str.c_str(), -1, Buff.GetData(), Buff.Num());
-
-		return FString(Buff.GetData());
+		const std::basic_string<TCHAR> Decoded = poml::decode_cp932<TCHAR>(Str);
+		return FString(static_cast<int32>(Decoded.size()), Decoded.data());
 	}
 
 	FVector ConvertLocation(const FVmdVector3& VmdLocation)
@@ -77,20 +71,54 @@ UObject* UVmdFactory::FactoryCreateBinary(UClass* InClass, UObject* InParent, FN
 {
 	UObject* ImportedObject = nullptr;
 
-	poml::VmdBase<FVector3f, FVector4f> Vmd;
-	if (!poml::import_vmd(Buffer, BufferEnd - Buffer, Vmd))
+	FMmdImportData Data;
+	FString CachePath;
+	uint64 CacheKey = 0;
+
+	if (bUseImportCache && !CurrentFilename.IsEmpty())
 	{
-		UE_LOG(LogTemp, Error, TEXT("Failed to import VMD file."));
-		return nullptr;
+		CachePath = MmdImportCache::GetCachePath(CurrentFilename);
+		CacheKey = MmdImportCache::MakeKey(Buffer, BufferEnd - Buffer, GetImportOptionsHash());
 	}
 
-	bool bHasAnimation = !Vmd.motion_tracks.empty() || !Vmd.morph_tracks.empty();
-	bool bHasCamera = !Vmd.camera_track.empty();
+	if (!CachePath.IsEmpty() && MmdImportCache::Load(CachePath, CacheKey, Data))
+	{
+		UE_LOG(LogTemp, Log, TEXT("Loaded %s from import cache."), *InName.ToString());
+	}
+	else
+	{
+		// Decode on the task graph rather than on threads of poml's own.
+		const poml::io::Executor TaskGraph = [](size_t Count, const std::function<void(size_t)>& Body)
+		{
+			ParallelFor(static_cast<int32>(Count), [&Body](int32 Index)
+				{
+					Body(Index);
+				});
+		};
+
+		poml::VmdBase<FVector3f, FVector4f> Vmd;
+		if (!poml::import_vmd_parallel(Buffer, BufferEnd - Buffer, Vmd, TaskGraph))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to import VMD file."));
+			return nullptr;
+		}
+
+		ConvertAnimation(Vmd, InName, Data);
+		ConvertCamera(Vmd, Data);
+
+		if (!CachePath.IsEmpty() && !MmdImportCache::Save(CachePath, CacheKey, Data))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed to write import cache %s."), *CachePath);
+		}
+	}
+
+	bool bHasAnimation = !Data.BoneTracks.IsEmpty() || !Data.MorphTracks.IsEmpty();
+	bool bHasCamera = !Data.CameraKeys.IsEmpty();
 
 	if (bHasAnimation)
 	{
 		FName Name = InName;
-		UMmdAnimationSequence* AnimationSequence = ImportAnimaionSequence(Vmd, InParent, Name, Flags);
+		UMmdAnimationSequence* AnimationSequence = ImportAnimaionSequence(Data, InParent, Name, Flags);
 
 		if (!ImportedObject)
 		{
@@ -105,7 +133,7 @@ UObject* UVmdFactory::FactoryCreateBinary(UClass* InClass, UObject* InParent, FN
 	if (bHasCamera)
 	{
 		FName Name = bHasAnimation ? FName(InName.ToString() + TEXT("_Camera")) : InName;
-		UMmdCameraSequence* CameraSequence = ImportCameraSequence(Vmd, InParent, Name, Flags);
+		UMmdCameraSequence* CameraSequence = ImportCameraSequence(Data, InParent, Name, Flags);
 
 		if (!ImportedObject)
 		{
@@ -120,14 +148,23 @@ UObject* UVmdFactory::FactoryCreateBinary(UClass* InClass, UObject* InParent, FN
 	return ImportedObject;
 }
 
-UMmdAnimationSequence* UVmdFactory::ImportAnimaionSequence(const FVmd& Vmd, UObject* InParent, FName InName, EObjectFlags Flags)
+uint64 UVmdFactory::GetImportOptionsHash() const
 {
-	UMmdAnimationSequence* Sequence = NewObject<UMmdAnimationSequence>(InParent, InName, Flags);
+	const float Options[] = {
+		bReduceBoneKeys ? 1.f : 0.f,
+		bReduceBoneKeys ? BonePositionTolerance : 0.f,
+		bReduceBoneKeys ? BoneAngleTolerance : 0.f,
+	};
+	return CityHash64(reinterpret_cast<const char*>(Options), sizeof(Options));
+}
 
+void UVmdFactory::ConvertAnimation(const FVmd& Vmd, FName InName, FMmdImportData& OutData) const
+{
 	for (auto& [Name, VmdKeys] : Vmd.motion_tracks)
 	{
-		FMmdBoneTrack Track;
+		FMmdBoneTrack& Track = OutData.BoneTracks.AddDefaulted_GetRef();
 		Track.Name = ShiftJisToString(Name);
+		Track.Keys.Reserve(VmdKeys.size());
 
 		for (auto& VmdKey : VmdKeys)
 		{
@@ -142,14 +179,13 @@ UMmdAnimationSequence* UVmdFactory::ImportAnimaionSequence(const FVmd& Vmd, UObj
 
 			Track.Keys.Add(Key);
 		}
-
-		Sequence->BoneTracks.Add(Track);
 	}
 
 	for (auto& [Name, VmdKeys] : Vmd.morph_tracks)
 	{
-		FMmdMorphTrack Track;
+		FMmdMorphTrack& Track = OutData.MorphTracks.AddDefaulted_GetRef();
 		Track.Name = ShiftJisToString(Name);
+		Track.Keys.Reserve(VmdKeys.size());
 
 		for (auto& VmdKey : VmdKeys)
 		{
@@ -159,16 +195,26 @@ UMmdAnimationSequence* UVmdFactory::ImportAnimaionSequence(const FVmd& Vmd, UObj
 
 			Track.Keys.Add(Key);
 		}
-
-		Sequence->MorphTracks.Add(Track);
 	}
 
-	return Sequence;
+	if (bReduceBoneKeys)
+	{
+		TArray<FMmdBoneTrack>& BoneTracks = OutData.BoneTracks;
+		std::atomic<int32> NumRemovedKeys = 0;
+
+		ParallelFor(BoneTracks.Num(), [&](int32 TrackIndex)
+			{
+				NumRemovedKeys += BoneTracks[TrackIndex].ReduceKeys(BonePositionTolerance, BoneAngleTolerance);
+			});
+
+		UE_LOG(LogTemp, Log, TEXT("Removed %d bone keys from %s."), NumRemovedKeys.load(), *InName.ToString());
+	}
 }
 
-UMmdCameraSequence* UVmdFactory::ImportCameraSequence(const FVmd& Vmd, UObject* InParent, FName InName, EObjectFlags Flags)
+void UVmdFactory::ConvertCamera(const FVmd& Vmd, FMmdImportData& OutData) const
 {
-	UMmdCameraSequence* Sequence = NewObject<UMmdCameraSequence>(InParent, InName, Flags);
+	TArray<FMmdCameraKey>& Keys = OutData.CameraKeys;
+	Keys.Reserve(Vmd.camera_track.size());
 
 	for (auto& VmdKey : Vmd.camera_track)
 	{
@@ -186,13 +232,13 @@ UMmdCameraSequence* UVmdFactory::ImportCameraSequence(const FVmd& Vmd, UObject*
 		Key.DistanceInterpolation = ConvertInterpolation(VmdKey.id);
 		Key.FieldOfViewInterpolation = ConvertInterpolation(VmdKey.iv);
 
-		Sequence->Keys.Add(Key);
+		Keys.Add(Key);
 	}
 
-	for (int32 i = 1, NumKeys = Sequence->Keys.Num(); i < NumKeys; ++i)
+	for (int32 i = 1, NumKeys = Keys.Num(); i < NumKeys; ++i)
 	{
-		FMmdCameraKey& Key = Sequence->Keys[i];
-		const FMmdCameraKey& Prev = Sequence->Keys[i - 1];
+		FMmdCameraKey& Key = Keys[i];
+		const FMmdCameraKey& Prev = Keys[i - 1];
 
 		if (Key.Frame == Prev.Frame + 1)
 		{
@@ -203,6 +249,26 @@ UMmdCameraSequence* UVmdFactory::ImportCameraSequence(const FVmd& Vmd, UObject*
 			Key.Cut = Prev.Cut;
 		}
 	}
+}
+
+UMmdAnimationSequence* UVmdFactory::ImportAnimaionSequence(FMmdImportData& Data, UObject* InParent, FName InName, EObjectFlags Flags)
+{
+	UMmdAnimationSequence* Sequence = NewObject<UMmdAnimationSequence>(InParent, InName, Flags);
+	Sequence->BoneTracks = MoveTemp(Data.BoneTracks);
+	Sequence->MorphTracks = MoveTemp(Data.MorphTracks);
+	Sequence->bCompressBoneKeys = bCompressBoneKeys;
+	Sequence->UpdateBoneKeyCompression();
+	Sequence->CacheTrackNames();
+
+	return Sequence;
+}
+
+UMmdCameraSequence* UVmdFactory::ImportCameraSequence(FMmdImportData& Data, UObject* InParent, FName InName, EObjectFlags Flags)
+{
+	UMmdCameraSequence* Sequence = NewObject<UMmdCameraSequence>(InParent, InName, Flags);
+	Sequence->Keys = MoveTemp(Data.CameraKeys);
+	Sequence->BindInterpolations();
+	Sequence->Bake();
 
 	return Sequence;
 }
@@ -8,6 +8,7 @@
 
 class UAnimSequence;
 class UMmdAnimationSequence;
+class UMmdBoneNameMapping;
 
 UCLASS(BlueprintType, Category = "MiniMmdTools")
 class MINIMMDTOOLSED_API UMmdEditorBlueprintFunctionLibrary : public UBlueprintFunctionLibrary
@@ -15,6 +16,14 @@ class MINIMMDTOOLSED_API UMmdEditorBlueprintFunctionLibrary : public UBlueprintF
 	GENERATED_BODY()
 	
 public:
+	// Writes every morph track as a curve in one bracket. Without bShouldTransact the change is not undoable.
+	// A positive ReductionTolerance drops keys which linear interpolation reproduces within the tolerance.
+	// Tracks are matched to morph targets by name, translated by NameMapping if given. Returns the number of dropped keys.
 	UFUNCTION(BlueprintCallable, Category = "MiniMmdTools")
-	static void ApplyMorph(UAnimSequence* AnimSequence, const UMmdAnimationSequence* MmdAnimationSequence, int32 FrameOffset = 0);
+	static int32 ApplyMorph(UAnimSequence* AnimSequence, const UMmdAnimationSequence* MmdAnimationSequence, int32 FrameOffset = 0, bool bShouldTransact = true, float ReductionTolerance = 0.f, const UMmdBoneNameMapping* NameMapping = nullptr);
+
+	// Resamples every bone track at the frame rate of the AnimSequence and writes them in one bracket.
+	// Tracks are matched to skeleton bones by name, translated by NameMapping if given, and applied on top of the reference pose (Delta * RefPose).
+	UFUNCTION(BlueprintCallable, Category = "MiniMmdTools")
+	static void ApplyBoneMotion(UAnimSequence* AnimSequence, const UMmdAnimationSequence* MmdAnimationSequence, int32 FrameOffset = 0, bool bShouldTransact = true, const UMmdBoneNameMapping* NameMapping = nullptr);
 };
@@ -9,6 +9,7 @@
 
 class UMmdAnimationSequence;
 class UMmdCameraSequence;
+struct FMmdImportData;
 
 /**
  * 
@@ -21,6 +22,25 @@ class MINIMMDTOOLSED_API UVmdFactory : public UFactory
 public:
 	UVmdFactory();
 
+	// Merge runs of bone keys into fewer keys with refitted interpolation curves on import.
+	UPROPERTY(EditAnywhere, Category = "MiniMmdTools")
+	bool bReduceBoneKeys = false;
+
+	UPROPERTY(EditAnywhere, Category = "MiniMmdTools", meta = (EditCondition = "bReduceBoneKeys", ClampMin = "0"))
+	float BonePositionTolerance = 0.1f;
+
+	UPROPERTY(EditAnywhere, Category = "MiniMmdTools", meta = (EditCondition = "bReduceBoneKeys", ClampMin = "0"))
+	float BoneAngleTolerance = 0.5f;
+
+	// Store bone keys of imported sequences quantized. See UMmdAnimationSequence::bCompressBoneKeys.
+	UPROPERTY(EditAnywhere, Category = "MiniMmdTools")
+	bool bCompressBoneKeys = false;
+
+	// Read and write converted keys in <file>.mmdcache next to the source, so unchanged files skip conversion.
+	// Off by default, since it writes into the source folder.
+	UPROPERTY(EditAnywhere, Category = "MiniMmdTools")
+	bool bUseImportCache = false;
+
 	virtual bool DoesSupportClass(UClass* Class)override;
 
 	virtual UObject* FactoryCreateBinary(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, UObject* Context, const TCHAR* Type, const uint8*& Buffer, const uint8* BufferEnd, FFeedbackContext* Warn)override;
@@ -28,7 +48,14 @@ public:
 private:
 	using FVmd = poml::VmdBase<FVector3f, FVector4f>;
 
-	UMmdAnimationSequence* ImportAnimaionSequence(const FVmd& Vmd, UObject* InParent, FName InName, EObjectFlags Flags);
+	// Options which change the converted keys, so that the cache is rebuilt when they change.
+	uint64 GetImportOptionsHash() const;
+
+	void ConvertAnimation(const FVmd& Vmd, FName InName, FMmdImportData& OutData) const;
+
+	void ConvertCamera(const FVmd& Vmd, FMmdImportData& OutData) const;
+
+	UMmdAnimationSequence* ImportAnimaionSequence(FMmdImportData& Data, UObject* InParent, FName InName, EObjectFlags Flags);
 
-	UMmdCameraSequence* ImportCameraSequence(const FVmd& Vmd, UObject* InParent, FName InName, EObjectFlags Flags);
+	UMmdCameraSequence* ImportCameraSequence(FMmdImportData& Data, UObject* InParent, FName InName, EObjectFlags Flags);
 };
@@ -8,6 +8,40 @@
 #include <fstream>
 #include <type_traits>
 #include <cstddef>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+#include <array>
+#include <span>
+#include <filesystem>
+#include <bit>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "poml_cp932.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <unistd.h>
+#define POML_HAS_MMAP
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define POML_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define POML_SIMD_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define POML_SIMD_NEON
+#endif
 
 // portable mmd library
 
@@ -26,14 +60,15 @@ namespace poml {
 		}
 	};
 
-	template<unsigned N = 8>
-	constexpr float calc_bezier(float x, float x1, float x2, float y1, float y2) {
-		auto bezier = [](float t, float p1, float p2) {
-			const float t2 = t * t;
-			const float t3 = t2 * t;
-			return (3.f * (p1 - p2) + 1.f) * t3 + 3.f * (-2.f * p1 + p2) * t2 + (3.f * p1) * t;
-		};
+	constexpr float bezier_at(float t, float p1, float p2) {
+		const float t2 = t * t;
+		const float t3 = t2 * t;
+		return (3.f * (p1 - p2) + 1.f) * t3 + 3.f * (-2.f * p1 + p2) * t2 + (3.f * p1) * t;
+	}
 
+	// Curve parameter t at which the x of the bezier equals x, solved with N Newton iterations.
+	template<unsigned N = 8>
+	constexpr float calc_bezier_param(float x, float x1, float x2) {
 		auto bezier1 = [](float t, float p1, float p2) {
 			const float t2 = t * t;
 			return 3.f * (3.f * (p1 - p2) + 1.f) * t2 + 6.f * (-2.f * p1 + p2) * t + (3.f * p1);
@@ -41,12 +76,282 @@ namespace poml {
 
 		float t = 0.8f * x + 0.1f; // Avoid division by zero when x == 0.f && x1 == 0.f.
 		for (unsigned i = 0; i < N; ++i) {
-			float ft = bezier(t, x1, x2) - x;
+			float ft = bezier_at(t, x1, x2) - x;
 			float ft1 = bezier1(t, x1, x2);
-			t = t - (ft / ft1);
+			if (ft1 != 0.f) { // The slope vanishes at t == 0.5 when x1 == 1 && x2 == 0.
+				t = t - (ft / ft1);
+			}
+		}
+
+		return t;
+	}
+
+	template<unsigned N = 8>
+	constexpr float calc_bezier(float x, float x1, float x2, float y1, float y2) {
+		return bezier_at(calc_bezier_param<N>(x, x1, x2), y1, y2);
+	}
+
+	namespace simd {
+#if defined(POML_SIMD_AVX2)
+		struct Lanes {
+			using V = __m256;
+			static constexpr size_t Width = 8;
+			static V load(const float* p) { return _mm256_loadu_ps(p); }
+			static void store(float* p, V v) { _mm256_storeu_ps(p, v); }
+			static V set(float f) { return _mm256_set1_ps(f); }
+			static V add(V a, V b) { return _mm256_add_ps(a, b); }
+			static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+			static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+			static V div(V a, V b) { return _mm256_div_ps(a, b); }
+			static V zero_where_zero(V m, V v) { return _mm256_and_ps(_mm256_cmp_ps(m, _mm256_setzero_ps(), _CMP_NEQ_UQ), v); }
+		};
+#elif defined(POML_SIMD_SSE2)
+		struct Lanes {
+			using V = __m128;
+			static constexpr size_t Width = 4;
+			static V load(const float* p) { return _mm_loadu_ps(p); }
+			static void store(float* p, V v) { _mm_storeu_ps(p, v); }
+			static V set(float f) { return _mm_set1_ps(f); }
+			static V add(V a, V b) { return _mm_add_ps(a, b); }
+			static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+			static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+			static V div(V a, V b) { return _mm_div_ps(a, b); }
+			static V zero_where_zero(V m, V v) { return _mm_and_ps(_mm_cmpneq_ps(m, _mm_setzero_ps()), v); }
+		};
+#elif defined(POML_SIMD_NEON)
+		struct Lanes {
+			using V = float32x4_t;
+			static constexpr size_t Width = 4;
+			static V load(const float* p) { return vld1q_f32(p); }
+			static void store(float* p, V v) { vst1q_f32(p, v); }
+			static V set(float f) { return vdupq_n_f32(f); }
+			static V add(V a, V b) { return vaddq_f32(a, b); }
+			static V sub(V a, V b) { return vsubq_f32(a, b); }
+			static V mul(V a, V b) { return vmulq_f32(a, b); }
+			static V div(V a, V b) { return vdivq_f32(a, b); }
+			static V zero_where_zero(V m, V v) { return vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(v), vceqq_f32(m, vdupq_n_f32(0.f)))); }
+		};
+#endif
+	}
+
+	// calc_bezier over SoA arrays: out[i] = calc_bezier<N>(x[i], x1[i], x2[i], y1[i], y2[i]).
+	template<unsigned N = 8>
+	void calc_bezier_batch(const float* x, const float* x1, const float* x2, const float* y1, const float* y2, float* out, size_t count) {
+		size_t i = 0;
+
+#if defined(POML_SIMD_AVX2) || defined(POML_SIMD_SSE2) || defined(POML_SIMD_NEON)
+		using L = simd::Lanes;
+		using V = L::V;
+
+		const V one = L::set(1.f), three = L::set(3.f), six = L::set(6.f), minus_two = L::set(-2.f);
+
+		// Same operation order as calc_bezier. Lanes may still differ from it in the last bits where the compiler
+		// contracts the scalar code into FMA.
+		auto bezier = [&](V t, V p1, V p2) {
+			const V t2 = L::mul(t, t);
+			const V t3 = L::mul(t2, t);
+			const V a = L::mul(L::add(L::mul(three, L::sub(p1, p2)), one), t3);
+			const V b = L::mul(L::mul(three, L::add(L::mul(minus_two, p1), p2)), t2);
+			return L::add(L::add(a, b), L::mul(L::mul(three, p1), t));
+		};
+
+		auto bezier1 = [&](V t, V p1, V p2) {
+			const V t2 = L::mul(t, t);
+			const V a = L::mul(L::mul(three, L::add(L::mul(three, L::sub(p1, p2)), one)), t2);
+			const V b = L::mul(L::mul(six, L::add(L::mul(minus_two, p1), p2)), t);
+			return L::add(L::add(a, b), L::mul(three, p1));
+		};
+
+		for (; i + L::Width <= count; i += L::Width) {
+			const V vx = L::load(x + i);
+			const V vx1 = L::load(x1 + i);
+			const V vx2 = L::load(x2 + i);
+
+			V t = L::add(L::mul(L::set(0.8f), vx), L::set(0.1f)); // Avoid division by zero when x == 0.f && x1 == 0.f.
+			for (unsigned n = 0; n < N; ++n) {
+				const V ft = L::sub(bezier(t, vx1, vx2), vx);
+				const V ft1 = bezier1(t, vx1, vx2);
+				t = L::sub(t, L::zero_where_zero(ft1, L::div(ft, ft1)));
+			}
+
+			L::store(out + i, bezier(t, L::load(y1 + i), L::load(y2 + i)));
+		}
+#endif
+
+		for (; i < count; ++i) {
+			out[i] = calc_bezier<N>(x[i], x1[i], x2[i], y1[i], y2[i]);
+		}
+	}
+
+	// calc_bezier sampled at N + 1 evenly spaced x, so that evaluation is one lookup and a lerp.
+	template<unsigned N = 128>
+	struct BezierTable {
+		static constexpr unsigned Size = N;
+
+		// Every user of a table validates it with is_accurate, over the same samples and tolerance.
+		static constexpr unsigned ValidationSamples = 1024;
+		static constexpr float MaxError = 1e-3f;
+
+		float samples[N + 2]; // The last sample is duplicated so that x == 1 needs no clamp.
+
+		constexpr BezierTable() : samples{} {}
+
+		constexpr BezierTable(float x1, float x2, float y1, float y2) : samples{} {
+			for (unsigned i = 0; i <= N; ++i) {
+				samples[i] = calc_bezier(static_cast<float>(i) / N, x1, x2, y1, y2);
+			}
+			samples[N + 1] = samples[N];
+		}
+
+		// x must be in [0, 1].
+		constexpr float operator()(float x) const {
+			const float f = x * N;
+			const unsigned i = static_cast<unsigned>(f);
+			const float a = f - static_cast<float>(i);
+			return samples[i] + a * (samples[i + 1] - samples[i]);
+		}
+
+		// Largest deviation from calc_bezier over num_samples + 1 evenly spaced x.
+		float max_error(float x1, float x2, float y1, float y2, unsigned num_samples = ValidationSamples) const {
+			float error = 0.f;
+			for (unsigned i = 0; i <= num_samples; ++i) {
+				const float x = static_cast<float>(i) / num_samples;
+				error = std::max(error, std::abs((*this)(x) - calc_bezier(x, x1, x2, y1, y2)));
+			}
+			return error;
+		}
+
+		// Whether the table may stand in for calc_bezier with these control points.
+		bool is_accurate(float x1, float x2, float y1, float y2) const {
+			return max_error(x1, x2, y1, y2) <= MaxError;
+		}
+	};
+
+	//
+	// CP932
+	//
+
+	namespace cp932 {
+		// What MultiByteToWideChar yields for undefined or truncated double byte sequences.
+		inline constexpr uint16_t Undefined = 0x30FB;
+
+		constexpr bool is_lead(uint8_t b) {
+			return (0x81 <= b && b <= 0x9F) || (0xE0 <= b && b <= 0xFC);
+		}
+
+		constexpr unsigned lead_index(uint8_t b) {
+			return b <= 0x9F ? b - 0x81u : b - 0xE0u + (0x9Fu - 0x81u + 1u);
+		}
+
+		// Widens count ASCII bytes.
+		template<typename Char>
+		inline void widen(const uint8_t* src, Char* dst, size_t count) {
+			for (size_t i = 0; i < count; ++i) {
+				dst[i] = static_cast<Char>(src[i]);
+			}
+		}
+
+		// Widens 16 bytes at once when they are all ASCII, otherwise returns the length of the ASCII prefix.
+		template<typename Char>
+		inline size_t widen_ascii16(const uint8_t* src, Char* dst) {
+#if defined(POML_SIMD_AVX2) || defined(POML_SIMD_SSE2)
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(bytes));
+			if (mask != 0) {
+				return static_cast<size_t>(std::countr_zero(mask));
+			}
+
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+			const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+			if constexpr (sizeof(Char) == 2) {
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), lo);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8), hi);
+			}
+			else {
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi16(lo, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4), _mm_unpackhi_epi16(lo, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8), _mm_unpacklo_epi16(hi, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 12), _mm_unpackhi_epi16(hi, zero));
+			}
+			return 16;
+#elif defined(POML_SIMD_NEON)
+			const uint8x16_t bytes = vld1q_u8(src);
+			if (vmaxvq_u8(bytes) >= 0x80) {
+				size_t n = 0;
+				while (src[n] < 0x80) {
+					++n;
+				}
+				return n;
+			}
+
+			const uint16x8_t lo = vmovl_u8(vget_low_u8(bytes));
+			const uint16x8_t hi = vmovl_u8(vget_high_u8(bytes));
+			if constexpr (sizeof(Char) == 2) {
+				vst1q_u16(reinterpret_cast<uint16_t*>(dst), lo);
+				vst1q_u16(reinterpret_cast<uint16_t*>(dst + 8), hi);
+			}
+			else {
+				vst1q_u32(reinterpret_cast<uint32_t*>(dst), vmovl_u16(vget_low_u16(lo)));
+				vst1q_u32(reinterpret_cast<uint32_t*>(dst + 4), vmovl_u16(vget_high_u16(lo)));
+				vst1q_u32(reinterpret_cast<uint32_t*>(dst + 8), vmovl_u16(vget_low_u16(hi)));
+				vst1q_u32(reinterpret_cast<uint32_t*>(dst + 12), vmovl_u16(vget_high_u16(hi)));
+			}
+			return 16;
+#else
+			size_t n = 0;
+			while (n < 16 && src[n] < 0x80) {
+				++n;
+			}
+			widen(src, dst, n);
+			return n;
+#endif
+		}
+	}
+
+	// Decodes CP932 (Shift-JIS with the Microsoft extensions) into UTF-16 or UTF-32 code units.
+	// Every CP932 character is in the BMP, so both yield one unit per character. Independent of the system code page.
+	template<typename Char>
+	inline std::basic_string<Char> decode_cp932(std::string_view text) {
+		static_assert(sizeof(Char) == 2 || sizeof(Char) == 4);
+
+		std::basic_string<Char> out(text.size(), Char{});
+		Char* dst = out.data();
+		const auto* src = reinterpret_cast<const uint8_t*>(text.data());
+		const auto* end = src + text.size();
+
+		while (src < end) {
+			if (end - src >= 16) {
+				const size_t n = cp932::widen_ascii16(src, dst);
+				if (n == 16) {
+					src += 16;
+					dst += 16;
+					continue;
+				}
+
+				cp932::widen(src, dst, n);
+				src += n;
+				dst += n;
+			}
+
+			const uint8_t lead = *src++;
+			if (lead < 0x80) {
+				*dst++ = static_cast<Char>(lead);
+			}
+			else if (!cp932::is_lead(lead)) {
+				*dst++ = static_cast<Char>(cp932::single_byte[lead]);
+			}
+			else if (src == end || *src < cp932::TrailFirst || *src > cp932::TrailLast) {
+				*dst++ = static_cast<Char>(cp932::Undefined);
+			}
+			else {
+				const uint16_t code = cp932::double_byte[cp932::lead_index(lead) * cp932::NumTrails + (*src++ - cp932::TrailFirst)];
+				*dst++ = static_cast<Char>(code != 0 ? code : cp932::Undefined);
+			}
 		}
 
-		return bezier(t, y1, y2);
+		out.resize(static_cast<size_t>(dst - out.data()));
+		return out;
 	}
 
 	//
@@ -101,7 +406,13 @@ namespace poml {
 
 	template<typename Vec2, typename Vec3, typename Vec4>
 	struct PmxBase {
-		using Text = std::wstring;
+		// UTF-16 regardless of the width of wchar_t. UTF-8 files are converted on import.
+		using Text = std::u16string;
+
+		enum Encode : uint8_t {
+			Utf16 = 0,
+			Utf8 = 1,
+		};
 
 		static constexpr char Magic[4] = { 0x50,0x4d,0x58,0x20 };
 		static constexpr float Version = 2.0f;
@@ -280,6 +591,7 @@ namespace poml {
 		};
 
 		float		version;
+		uint8_t		encode; // encoding of the text in the source file
 		uint8_t		num_ex_uvs;
 		uint8_t		vertex_index_size;
 		uint8_t		texture_index_size;
@@ -423,8 +735,15 @@ namespace poml {
 			return Key::interpolate(*key0, *key1, frame);
 		}
 
+		// Stable. Cheap for tracks that are already ordered or only have a disordered tail.
 		void sort() {
-			std::ranges::sort(keys, {}, &Key::frame);
+			auto sorted_end = std::ranges::is_sorted_until(keys, {}, &Key::frame);
+			if (sorted_end == keys.end()) {
+				return;
+			}
+
+			std::ranges::stable_sort(sorted_end, keys.end(), {}, &Key::frame);
+			std::ranges::inplace_merge(keys.begin(), sorted_end, keys.end(), {}, &Key::frame);
 		}
 	};
 
@@ -527,6 +846,218 @@ namespace poml {
 		std::map<Text, Track<IkKey>>		ik_tracks;
 	};
 
+	//
+	// Compiled Vmd
+	//
+
+	// Motion and morph tracks of a VmdBase flattened into contiguous per-field arrays for runtime evaluation.
+	// Each track is a range of the arrays. Interpolations are indices into a table of unique curves,
+	// and curves refer to their sample table by index as well.
+	struct CompiledVmd {
+		static constexpr uint32_t NoTable = ~0u;
+
+		struct Curve {
+			float		x1;
+			float		x2;
+			float		y1;
+			float		y2;
+			uint32_t	table; // NoTable when the table deviates too much from calc_bezier
+		};
+
+		struct TrackRange {
+			std::string	name;
+			uint32_t	first;
+			uint32_t	count;
+		};
+
+		std::vector<Curve>			curves;
+		std::vector<BezierTable<>>	tables;
+
+		std::vector<TrackRange>					motion_tracks;
+		std::vector<uint32_t>					motion_frames;
+		std::vector<std::array<float, 3>>		motion_positions;
+		std::vector<std::array<float, 4>>		motion_orientations;
+		std::vector<std::array<uint32_t, 4>>	motion_curves; // x, y, z, rotation
+
+		std::vector<TrackRange>	morph_tracks;
+		std::vector<uint32_t>	morph_frames;
+		std::vector<float>		morph_values;
+
+		// x must be in [0, 1].
+		float alpha_at(uint32_t curve_index, float x) const {
+			const auto& curve = curves[curve_index];
+			return curve.table != NoTable ? tables[curve.table](x) : calc_bezier(x, curve.x1, curve.x2, curve.y1, curve.y2);
+		}
+
+		// Index of the first key after frame within the range, clamped so that [index - 1, index] is a valid pair.
+		std::pair<uint32_t, uint32_t> find_keys(const std::vector<uint32_t>& frames, const TrackRange& track, float frame) const {
+			auto first = frames.begin() + track.first;
+			auto last = first + track.count;
+			auto it = std::upper_bound(first, last, frame, [](float f, uint32_t key) { return f < static_cast<float>(key); });
+
+			if (it == first) {
+				return { track.first, track.first };
+			}
+			else if (it == last) {
+				return { track.first + track.count - 1, track.first + track.count - 1 };
+			}
+			else {
+				auto index1 = static_cast<uint32_t>(it - frames.begin());
+				return { index1 - 1, index1 };
+			}
+		}
+
+		// Samples a motion track at a fractional frame. The segment is shaped by the curves of its second key.
+		void sample_motion(size_t track, float frame, float (&position)[3], float (&orientation)[4]) const {
+			const auto& range = motion_tracks[track];
+			if (range.count == 0) {
+				position[0] = position[1] = position[2] = 0.f;
+				orientation[0] = orientation[1] = orientation[2] = 0.f;
+				orientation[3] = 1.f;
+				return;
+			}
+
+			auto [key0, key1] = find_keys(motion_frames, range, frame);
+			const auto& p0 = motion_positions[key0];
+			const auto& p1 = motion_positions[key1];
+			const auto& q0 = motion_orientations[key0];
+			const auto& q1 = motion_orientations[key1];
+
+			if (key0 == key1) {
+				std::copy(p0.begin(), p0.end(), position);
+				std::copy(q0.begin(), q0.end(), orientation);
+				return;
+			}
+
+			const float time = (frame - motion_frames[key0]) / static_cast<float>(motion_frames[key1] - motion_frames[key0]);
+			const auto& curve = motion_curves[key1];
+
+			for (int i = 0; i < 3; ++i) {
+				const float alpha = alpha_at(curve[i], time);
+				position[i] = p0[i] + alpha * (p1[i] - p0[i]);
+			}
+
+			slerp(q0, q1, alpha_at(curve[3], time), orientation);
+		}
+
+		float sample_morph(size_t track, float frame) const {
+			const auto& range = morph_tracks[track];
+			if (range.count == 0) {
+				return 0.f;
+			}
+
+			auto [key0, key1] = find_keys(morph_frames, range, frame);
+			if (key0 == key1) {
+				return morph_values[key0];
+			}
+
+			const float time = (frame - morph_frames[key0]) / static_cast<float>(morph_frames[key1] - morph_frames[key0]);
+			return morph_values[key0] + time * (morph_values[key1] - morph_values[key0]);
+		}
+
+		static void slerp(const std::array<float, 4>& q0, const std::array<float, 4>& q1, float t, float (&out)[4]) {
+			float cos = q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3];
+			const float sign = cos < 0.f ? -1.f : 1.f;
+			cos *= sign;
+
+			float s0 = 1.f - t;
+			float s1 = t;
+			if (cos < 0.9999f) {
+				const float omega = std::acos(cos);
+				const float inv_sin = 1.f / std::sin(omega);
+				s0 = std::sin((1.f - t) * omega) * inv_sin;
+				s1 = std::sin(t * omega) * inv_sin;
+			}
+			s1 *= sign;
+
+			float len = 0.f;
+			for (int i = 0; i < 4; ++i) {
+				out[i] = s0 * q0[i] + s1 * q1[i];
+				len += out[i] * out[i];
+			}
+
+			if (len > 0.f) {
+				const float inv_len = 1.f / std::sqrt(len);
+				for (int i = 0; i < 4; ++i) {
+					out[i] *= inv_len;
+				}
+			}
+		}
+	};
+
+	template<typename Vec3, typename Vec4>
+	inline CompiledVmd compile_vmd(const VmdBase<Vec3, Vec4>& vmd) {
+		static_assert(sizeof(Vec3) == sizeof(float) * 3 && sizeof(Vec4) == sizeof(float) * 4);
+
+		CompiledVmd compiled;
+		std::map<uint32_t, uint32_t> curve_indices; // packed control points - curve index
+
+		auto intern_curve = [&](const Interpolation& interpolation) {
+			uint32_t packed;
+			std::memcpy(&packed, &interpolation, sizeof(packed));
+
+			auto [it, inserted] = curve_indices.try_emplace(packed, static_cast<uint32_t>(compiled.curves.size()));
+			if (inserted) {
+				auto& curve = compiled.curves.emplace_back();
+				curve.x1 = interpolation.x1 / 127.f;
+				curve.x2 = interpolation.x2 / 127.f;
+				curve.y1 = interpolation.y1 / 127.f;
+				curve.y2 = interpolation.y2 / 127.f;
+				curve.table = CompiledVmd::NoTable;
+
+				BezierTable<> table(curve.x1, curve.x2, curve.y1, curve.y2);
+				if (table.is_accurate(curve.x1, curve.x2, curve.y1, curve.y2)) {
+					curve.table = static_cast<uint32_t>(compiled.tables.size());
+					compiled.tables.push_back(table);
+				}
+			}
+
+			return it->second;
+		};
+
+		size_t num_motion_keys = 0;
+		for (auto& [name, track] : vmd.motion_tracks) {
+			num_motion_keys += track.size();
+		}
+
+		compiled.motion_tracks.reserve(vmd.motion_tracks.size());
+		compiled.motion_frames.reserve(num_motion_keys);
+		compiled.motion_positions.reserve(num_motion_keys);
+		compiled.motion_orientations.reserve(num_motion_keys);
+		compiled.motion_curves.reserve(num_motion_keys);
+
+		for (auto& [name, track] : vmd.motion_tracks) {
+			compiled.motion_tracks.push_back({ name, static_cast<uint32_t>(compiled.motion_frames.size()), static_cast<uint32_t>(track.size()) });
+
+			for (auto& key : track) {
+				compiled.motion_frames.push_back(key.frame);
+				std::memcpy(compiled.motion_positions.emplace_back().data(), &key.position, sizeof(float) * 3);
+				std::memcpy(compiled.motion_orientations.emplace_back().data(), &key.orientation, sizeof(float) * 4);
+				compiled.motion_curves.push_back({ intern_curve(key.ix), intern_curve(key.iy), intern_curve(key.iz), intern_curve(key.ir) });
+			}
+		}
+
+		size_t num_morph_keys = 0;
+		for (auto& [name, track] : vmd.morph_tracks) {
+			num_morph_keys += track.size();
+		}
+
+		compiled.morph_tracks.reserve(vmd.morph_tracks.size());
+		compiled.morph_frames.reserve(num_morph_keys);
+		compiled.morph_values.reserve(num_morph_keys);
+
+		for (auto& [name, track] : vmd.morph_tracks) {
+			compiled.morph_tracks.push_back({ name, static_cast<uint32_t>(compiled.morph_frames.size()), static_cast<uint32_t>(track.size()) });
+
+			for (auto& key : track) {
+				compiled.morph_frames.push_back(key.frame);
+				compiled.morph_values.push_back(key.value);
+			}
+		}
+
+		return compiled;
+	}
+
 	namespace io {
 		template<int32_t N>
 		struct VectorMarker {
@@ -582,6 +1113,10 @@ namespace poml {
 
 				if constexpr (N == 0) {
 					copy<int32_t>(&len);
+					if (len < 0) {
+						ptr = end + 1;
+						return;
+					}
 					len /= sizeof(Char);
 				}
 
@@ -592,15 +1127,140 @@ namespace poml {
 					if constexpr (N != 0) {
 						// Determine the actual string length.
 						if constexpr (sizeof(Char) == 1) {
-							len = static_cast<int32_t>(strnlen_s(reinterpret_cast<const char*>(cur), N));
+							auto nul = std::memchr(cur, 0, N);
+							len = nul ? static_cast<int32_t>(static_cast<const std::byte*>(nul) - cur) : N;
+						}
+						else {
+							Char c{};
+							for (len = 0; len < N; ++len) {
+								std::memcpy(&c, cur + sizeof(Char) * len, sizeof(Char));
+								if (c == Char{}) {
+									break;
+								}
+							}
 						}
-						else if constexpr (sizeof(Char) == 2) {
-							len = static_cast<int32_t>(wcsnlen_s(reinterpret_cast<const wchar_t*>(cur), N));
+					}
+
+					// memcpy instead of assign, since the source may be unaligned for Char.
+					dst->resize(len);
+					std::memcpy(dst->data(), cur, sizeof(Char) * len);
+				}
+			}
+
+			// Reads a length-prefixed UTF-8 string into UTF-16, reusing the capacity of dst.
+			void copy_text_utf8(std::u16string* dst) {
+				int32_t len = 0;
+				copy<int32_t>(&len);
+
+				auto cur = reinterpret_cast<const uint8_t*>(ptr);
+				ptr += len;
+
+				if (len < 0 || ptr > end) {
+					ptr = end + 1;
+					return;
+				}
+
+				// A UTF-8 sequence never has fewer bytes than its UTF-16 units.
+				dst->resize(len);
+				char16_t* out = dst->data();
+
+				for (auto last = cur + len; cur < last;) {
+					const uint8_t lead = *cur++;
+					uint32_t code = 0xFFFD;
+					int trail = 0;
+
+					if (lead < 0x80) {
+						code = lead;
+					}
+					else if (0xC2 <= lead && lead < 0xE0) {
+						code = lead & 0x1F;
+						trail = 1;
+					}
+					else if (0xE0 <= lead && lead < 0xF0) {
+						code = lead & 0x0F;
+						trail = 2;
+					}
+					else if (0xF0 <= lead && lead < 0xF5) {
+						code = lead & 0x07;
+						trail = 3;
+					}
+
+					if (last - cur < trail) {
+						code = 0xFFFD;
+						cur = last;
+						trail = 0;
+					}
+
+					for (int i = 0; i < trail; ++i) {
+						if ((cur[i] & 0xC0) != 0x80) {
+							code = 0xFFFD;
+							trail = i;
+							break;
 						}
+						code = (code << 6) | (cur[i] & 0x3F);
+					}
+					cur += trail;
+
+					// Reject overlong forms, surrogates and code points beyond U+10FFFF.
+					static constexpr uint32_t min_code[] = { 0, 0x80, 0x800, 0x10000 };
+					if (code != 0xFFFD && (code < min_code[trail] || (0xD800 <= code && code < 0xE000) || code > 0x10FFFF)) {
+						code = 0xFFFD;
+					}
+
+					if (code < 0x10000) {
+						*out++ = static_cast<char16_t>(code);
+					}
+					else {
+						code -= 0x10000;
+						*out++ = static_cast<char16_t>(0xD800 | (code >> 10));
+						*out++ = static_cast<char16_t>(0xDC00 | (code & 0x3FF));
 					}
+				}
+
+				dst->resize(out - dst->data());
+			}
+
+			// Same as copy and cast for fields of a range which was checked as a whole.
+			template<typename Src, typename Dst>
+			void copy_unchecked(Dst* dst) {
+				std::memcpy(dst, ptr, sizeof(Src));
+				ptr += sizeof(Src);
+			}
+
+			template<typename Src, typename Dst>
+			void cast_unchecked(Dst* dst) {
+				Src tmp;
+				std::memcpy(&tmp, ptr, sizeof(Src));
+				ptr += sizeof(Src);
+				*dst = static_cast<Dst>(tmp);
+			}
 
-					dst->assign(reinterpret_cast<const Char*>(cur), len);
+			// Checks once that count records of record_size bytes follow, and skips them.
+			// Returns the first record, or null after marking the reader as overflown.
+			const std::byte* take(size_t count, size_t record_size) {
+				if (ptr > end || static_cast<size_t>(end - ptr) / record_size < count) {
+					ptr = end + 1;
+					return nullptr;
 				}
+
+				auto first = ptr;
+				ptr += count * record_size;
+				return first;
+			}
+
+			// Reads the count of a section whose records have at least min_size bytes each.
+			// A negative count, or one that cannot fit in the rest of the buffer, marks the reader as overflown
+			// and yields 0, so that malformed input never sizes a huge allocation.
+			size_t read_count(size_t min_size) {
+				int32_t count = 0;
+				copy<int32_t>(&count);
+
+				if (count < 0 || ptr > end || static_cast<size_t>(end - ptr) / min_size < static_cast<size_t>(count)) {
+					ptr = end + 1;
+					return 0;
+				}
+
+				return static_cast<size_t>(count);
 			}
 
 			bool is_overflown() const {
@@ -612,25 +1272,27 @@ namespace poml {
 			}
 		};
 
-		template<typename Src = void, int32_t N = 0>
+		// Unchecked readers decode a range that was checked as a whole by take() without a branch per field.
+		template<typename Src = void, int32_t Length = 0, bool Checked = true>
 		struct BufferReader : BufferReaderBase {
 			template<typename T>
 			auto& as() {
-				return *reinterpret_cast<BufferReader<T>*>(this);
+				return *reinterpret_cast<BufferReader<T, 0, Checked>*>(this);
 			}
 
 			auto& as_vec2() {
-				return *reinterpret_cast<BufferReader<VectorMarker<2>>*>(this);
+				return *reinterpret_cast<BufferReader<VectorMarker<2>, 0, Checked>*>(this);
 			}
 
 			auto& as_vec3() {
-				return *reinterpret_cast<BufferReader<VectorMarker<3>>*>(this);
+				return *reinterpret_cast<BufferReader<VectorMarker<3>, 0, Checked>*>(this);
 			}
 
 			auto& as_vec4() {
-				return *reinterpret_cast<BufferReader<VectorMarker<4>>*>(this);
+				return *reinterpret_cast<BufferReader<VectorMarker<4>, 0, Checked>*>(this);
 			}
 
+			// Text is always checked, since its length comes from the data.
 			template<int32_t Len = 0>
 			auto& as_texta() {
 				return *reinterpret_cast<BufferReader<char, Len>*>(this);
@@ -638,14 +1300,38 @@ namespace poml {
 
 			template<int32_t Len = 0>
 			auto& as_textw() {
-				return *reinterpret_cast<BufferReader<wchar_t, Len>*>(this);
+				return *reinterpret_cast<BufferReader<char16_t, Len>*>(this);
+			}
+
+			auto& as_text_utf8() {
+				return *reinterpret_cast<BufferReader<char8_t>*>(this);
+			}
+
+			template<typename S, typename D>
+			void copy_field(D* dst) {
+				if constexpr (Checked) {
+					this->template copy<S>(dst);
+				}
+				else {
+					this->template copy_unchecked<S>(dst);
+				}
+			}
+
+			template<typename S, typename D>
+			void cast_field(D* dst) {
+				if constexpr (Checked) {
+					this->template cast<S>(dst);
+				}
+				else {
+					this->template cast_unchecked<S>(dst);
+				}
 			}
 
 			template<typename Dst>
 			auto read() {
-				Dst dst;
+				Dst dst{};
 
-				copy<Dst>(&dst);
+				copy_field<Dst>(&dst);
 
 				return dst;
 			}
@@ -700,42 +1386,49 @@ namespace poml {
 
 			template<int32_t N = 0>
 			auto read_textw() {
-				return read_text<wchar_t, N>();
+				return read_text<char16_t, N>();
 			}
 		};
 
-		template<typename Src, int32_t N, typename Dst>
-		Dst& operator<<(Dst& dst, BufferReader<Src, N>& buff) {
+		template<typename Src, int32_t N, bool Checked, typename Dst>
+		Dst& operator<<(Dst& dst, BufferReader<Src, N, Checked>& buff) {
 			static_assert(std::is_trivially_copyable_v<Src> && std::is_trivially_copyable_v<Dst>);
 
 			if constexpr (std::is_same_v<Src, Dst>) {
-				buff.copy<Src>(&dst);
+				buff.template copy_field<Src>(&dst);
 			}
 			else {
-				buff.cast<Src>(&dst);
+				buff.template cast_field<Src>(&dst);
 			}
 
 			return dst;
 		}
 
-		template<typename Dst>
-		Dst& operator<<(Dst& dst, BufferReader<void>& buff) {
+		template<typename Dst, bool Checked>
+		Dst& operator<<(Dst& dst, BufferReader<void, 0, Checked>& buff) {
 			static_assert(std::is_trivially_copyable_v<Dst>);
 
-			buff.copy<Dst>(&dst);
+			buff.template copy_field<Dst>(&dst);
 
 			return dst;
 		}
 
-		template<typename Dst, int32_t N>
-		Dst& operator<<(Dst& dst, BufferReader<VectorMarker<N>>& buff) {
-			buff.copy<VectorMarker<N>>(&dst);
+		template<typename Dst, int32_t N, bool Checked>
+		Dst& operator<<(Dst& dst, BufferReader<VectorMarker<N>, 0, Checked>& buff) {
+			buff.template copy_field<VectorMarker<N>>(&dst);
 			return dst;
 		}
 
+		using RecordReader = BufferReader<void, 0, false>;
+
 		template<typename Char, int32_t N>
 		std::basic_string<Char>& operator<<(std::basic_string<Char>& dst, BufferReader<Char, N>& buff) {
-			buff.copy_text<Char, N>(&dst);
+			buff.template copy_text<Char, N>(&dst);
+			return dst;
+		}
+
+		inline std::u16string& operator<<(std::u16string& dst, BufferReader<char8_t>& buff) {
+			buff.copy_text_utf8(&dst);
 			return dst;
 		}
 
@@ -743,65 +1436,261 @@ namespace poml {
 		// Writer
 		//
 
-		struct BufferWriterBase {
-			std::vector<std::byte> buff{};
+		// Receives a streamed image in order, one chunk at a time. Returns false to fail the export.
+		// The stream ends with one call of size 0, on which the sink flushes and reports whether everything was stored.
+		using Sink = std::function<bool(const std::byte* data, size_t size)>;
 
-			std::byte* require(size_t N) {
-				auto contained = buff.size();
-				buff.resize(contained + N);
-				return buff.data() + contained;
+		// Calls a sink on one long-lived thread. One chunk is queued at a time, so the caller can fill
+		// the next chunk meanwhile and reuse a chunk once the following push returns.
+		class SinkThread {
+		public:
+			explicit SinkThread(Sink to_sink) :
+				sink(std::move(to_sink)),
+				thread([this]() { run(); }) {}
+
+			SinkThread(const SinkThread&) = delete;
+			SinkThread& operator=(const SinkThread&) = delete;
+
+			~SinkThread() {
+				close();
 			}
 
-			void skip(size_t N) {
-				if (N == 0) {
-					return;
+			// Waits until the queued chunk is taken by the sink, then queues this one. Returns false once the sink failed.
+			bool push(const std::byte* data, size_t size) {
+				std::unique_lock lock(mutex);
+				idle.wait(lock, [this]() { return !queued; });
+				if (failed) {
+					return false;
 				}
 
-				buff.resize(buff.size() + N);
+				chunk = { data, size };
+				queued = true;
+				ready.notify_one();
+				return true;
 			}
 
-			template<typename Dst, typename Src>
-			void write(const Src& src) {
-				static_assert(sizeof(Dst) <= sizeof(Src));
-				std::memcpy(require(sizeof(Dst)), &src, sizeof(Dst));
-			}
+			// Waits for the queued chunk, stops the thread and ends the stream. Returns whether the sink stored everything.
+			bool close() {
+				{
+					std::unique_lock lock(mutex);
+					idle.wait(lock, [this]() { return !queued; });
+					stopping = true;
+					ready.notify_one();
+				}
 
-			template<typename Src>
-			void write_array(const Src* src, size_t N) {
-				auto size = sizeof(Src) * N;
-				std::memcpy(require(size), src, size);
+				if (thread.joinable()) {
+					thread.join();
+
+					if (!failed && !sink(nullptr, 0)) {
+						failed = true;
+					}
+				}
+
+				return !failed;
 			}
 
-			template<typename Char, int32_t N>
-			void write_text(const std::basic_string<Char>& src) {
-				int32_t len = N;
+		private:
+			Sink sink;
+			std::mutex mutex;
+			std::condition_variable ready;
+			std::condition_variable idle;
+			std::span<const std::byte> chunk{};
+			bool queued = false;
+			bool stopping = false;
+			bool failed = false;
+			std::thread thread; // last, so that it starts after the state above is constructed
+
+			void run() {
+				std::unique_lock lock(mutex);
+				for (;;) {
+					ready.wait(lock, [this]() { return queued || stopping; });
+					if (!queued) {
+						return;
+					}
 
-				if constexpr (N == 0) {
-					len = static_cast<int32_t>(src.length());
-					write<int32_t>(static_cast<int32_t>(sizeof(Char) * len));
-				}
+					const auto data = chunk;
+					lock.unlock();
+					const bool ok = sink(data.data(), data.size());
+					lock.lock();
 
-				if constexpr (N == 0) {
-					write_array(src.c_str(), len);
+					failed = failed || !ok;
+					queued = false;
+					idle.notify_all();
 				}
-				else {
-					len = std::min(N, static_cast<int32_t>(src.length()));
+			}
+		};
 
-					write_array(src.c_str(), len);
-					skip(sizeof(Char) * (N - len));
-				}
+		// Writes into a span sized up front. Without a span the writes are only counted,
+		// so an exporter runs once to measure its output and once more to write it.
+		// When streaming, the span is one of two chunks: a full chunk is handed to the sink
+		// on the writer thread while the next one is filled.
+		struct BufferWriterBase {
+			static constexpr size_t MinChunkSize = 4096;
+			static constexpr size_t DefaultChunkSize = 1 << 20;
+
+			std::byte* first = nullptr;
+			size_t capacity = 0;
+			size_t used = 0;
+			size_t contained = 0;
+			bool overflown = false;
+			std::unique_ptr<std::byte[]> storage{};
+
+			bool sink_failed = false;
+			std::unique_ptr<SinkThread> writer{}; // after storage, so that it stops before the chunks are freed
+
+			// Counts the following writes without storing them.
+			void measure() {
+				attach(nullptr, 0);
 			}
 
-			const std::byte* data() const {
-				return buff.data();
+			// Writes into dst. Writes past size are dropped and mark the writer as overflown.
+			void attach(std::byte* dst, size_t size) {
+				finish();
+
+				first = dst;
+				capacity = size;
+				used = 0;
+				contained = 0;
+				overflown = false;
+				sink_failed = false;
 			}
 
-			size_t size() const {
-				return buff.size();
+			// Writes into owned storage of exactly size bytes, left uninitialized.
+			void allocate(size_t size) {
+				finish();
+				storage.reset(new std::byte[size]);
+				attach(storage.get(), size);
+			}
+
+			// Streams the following writes to to_sink in chunks of up to chunk_size bytes. finish() must follow.
+			void stream(Sink to_sink, size_t chunk_size) {
+				chunk_size = std::max(chunk_size, MinChunkSize);
+				finish();
+				storage.reset(new std::byte[chunk_size * 2]);
+				attach(storage.get(), chunk_size);
+				writer = std::make_unique<SinkThread>(std::move(to_sink));
+			}
+
+			// Hands the rest of a stream to the sink, ends the stream and waits for it.
+			// Returns whether the sink stored every chunk.
+			bool finish() {
+				if (writer) {
+					if (used > 0) {
+						flush();
+					}
+
+					if (!writer->close()) {
+						sink_failed = true;
+					}
+					writer.reset();
+				}
+
+				return !sink_failed;
+			}
+
+			// Destination of the next N bytes, or null while measuring or past the end of the span.
+			// When streaming, N must not exceed a chunk.
+			std::byte* require(size_t N) {
+				if (used + N > capacity && writer) {
+					flush();
+				}
+
+				auto offset = used;
+				used += N;
+				contained += N;
+
+				if (used > capacity) {
+					overflown = overflown || first != nullptr;
+					return nullptr;
+				}
+
+				return first + offset;
+			}
+
+			void skip(size_t N) {
+				put(nullptr, N);
+			}
+
+			template<typename Dst, typename Src>
+			void write(const Src& src) {
+				static_assert(sizeof(Dst) <= sizeof(Src));
+				if (auto dst = require(sizeof(Dst))) {
+					std::memcpy(dst, &src, sizeof(Dst));
+				}
+			}
+
+			template<typename Src>
+			void write_array(const Src* src, size_t N) {
+				put(reinterpret_cast<const std::byte*>(src), sizeof(Src) * N);
+			}
+
+			template<typename Char, int32_t N>
+			void write_text(const std::basic_string<Char>& src) {
+				int32_t len = N;
+
+				if constexpr (N == 0) {
+					len = static_cast<int32_t>(src.length());
+					write<int32_t>(static_cast<int32_t>(sizeof(Char) * len));
+				}
+
+				if constexpr (N == 0) {
+					write_array(src.c_str(), len);
+				}
+				else {
+					len = std::min(N, static_cast<int32_t>(src.length()));
+
+					write_array(src.c_str(), len);
+					skip(sizeof(Char) * (N - len));
+				}
+			}
+
+			const std::byte* data() const {
+				return first;
+			}
+
+			size_t size() const {
+				return contained;
+			}
+
+			bool is_overflown() const {
+				return overflown;
+			}
+
+		private:
+			// Copies size bytes from src, or zeros without src, split so that no piece exceeds a chunk.
+			void put(const std::byte* src, size_t size) {
+				do {
+					const size_t piece = writer ? std::min(size, capacity) : size;
+
+					if (auto dst = require(piece)) {
+						if (src) {
+							std::memcpy(dst, src, piece);
+						}
+						else {
+							std::memset(dst, 0, piece);
+						}
+					}
+
+					if (src) {
+						src += piece;
+					}
+					size -= piece;
+				} while (size > 0);
+			}
+
+			// Hands the filled chunk to the sink and continues in the other one,
+			// which the sink is done with once push returns.
+			void flush() {
+				if (!sink_failed && !writer->push(first, used)) {
+					sink_failed = true;
+				}
+
+				first = first == storage.get() ? storage.get() + capacity : storage.get();
+				used = 0;
 			}
 		};
 
-		template<typename Dst = void, int32_t N = 0>
+		template<typename Dst = void, int32_t Length = 0>
 		struct BufferWriter : BufferWriterBase {
 			auto& as_vec2() {
 				return *reinterpret_cast<BufferWriter<VectorMarker<2>>*>(this);
@@ -822,26 +1711,26 @@ namespace poml {
 
 			template<int32_t N = 0>
 			auto& as_textw() {
-				return *reinterpret_cast<BufferWriter<wchar_t, N>*>(this);
+				return *reinterpret_cast<BufferWriter<char16_t, N>*>(this);
 			}
 		};
 
 		template<typename Src>
 		const Src& operator<<(BufferWriter<void>& buff, const Src& src) {
 			static_assert(std::is_trivially_copyable_v<Src>);
-			buff.write<Src>(src);
+			buff.template write<Src>(src);
 			return src;
 		}
 
 		template<typename Src, int32_t N>
 		const Src& operator<<(BufferWriter<VectorMarker<N>>& buff, const Src& src) {
-			buff.write<VectorMarker<N>>(src);
+			buff.template write<VectorMarker<N>>(src);
 			return src;
 		}
 
 		template<typename Char, int32_t N>
 		const std::basic_string<Char>& operator<<(BufferWriter<Char, N>& buff, const std::basic_string<Char>& src) {
-			buff.write_text<Char, N>(src);
+			buff.template write_text<Char, N>(src);
 			return src;
 		}
 
@@ -878,16 +1767,344 @@ namespace poml {
 			return true;
 		}
 
+		// Sink writing to a new or truncated file. Empty if the file cannot be opened.
+		// The end of the stream closes the file, so that a failing final flush fails the export.
+		template<typename Path>
+		inline Sink make_file_sink(const Path& path) {
+			auto ofs = std::make_shared<std::ofstream>(path, std::ios::binary);
+			if (!*ofs) {
+				return {};
+			}
+
+			return [ofs](const std::byte* data, size_t size) {
+				if (size == 0) {
+					ofs->flush();
+					ofs->close();
+					return !ofs->fail();
+				}
+
+				ofs->write(reinterpret_cast<const char*>(data), size);
+				return static_cast<bool>(*ofs);
+			};
+		}
+
+		// Streams into a sibling temporary file through a file sink, then renames it over path.
+		// The temporary file is removed on failure, so path keeps its previous content.
+		template<typename Path, typename Stream>
+		inline bool replace_file(const Path& path, Stream&& stream) {
+			const std::filesystem::path target(path);
+			auto temp = target;
+			temp += ".tmp";
+
+			bool ret = false;
+			{
+				auto sink = make_file_sink(temp);
+				ret = sink && stream(sink);
+			}
+
+			std::error_code ec;
+			if (ret) {
+				std::filesystem::rename(temp, target, ec);
+				ret = !ec;
+			}
+			if (!ret) {
+				std::filesystem::remove(temp, ec);
+			}
+			return ret;
+		}
+
+#ifdef POML_HAS_MMAP
+		// Sink writing to an open file descriptor, which stays owned by the caller. Writes are unbuffered,
+		// so the end of the stream has nothing left to flush.
+		inline Sink make_fd_sink(int fd) {
+			return [fd](const std::byte* data, size_t size) {
+				while (size > 0) {
+					auto written = ::write(fd, data, size);
+					if (written < 0) {
+						if (errno == EINTR) {
+							continue;
+						}
+						return false;
+					}
+
+					data += written;
+					size -= static_cast<size_t>(written);
+				}
+				return true;
+			};
+		}
+#endif
+
+		// Read-only view of a whole file. Mapped with mmap where available, read into memory elsewhere.
+		class MappedFile {
+		public:
+			MappedFile() = default;
+
+			template<typename Path>
+			explicit MappedFile(const Path& path) {
+				open(path);
+			}
+
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+
+			MappedFile(MappedFile&& other) noexcept {
+				*this = std::move(other);
+			}
+
+			MappedFile& operator=(MappedFile&& other) noexcept {
+				if (this != &other) {
+					close();
+					std::swap(ptr, other.ptr);
+					std::swap(len, other.len);
+					std::swap(mapped, other.mapped);
+					std::swap(bin, other.bin);
+				}
+				return *this;
+			}
+
+			~MappedFile() {
+				close();
+			}
+
+			template<typename Path>
+			bool open(const Path& path) {
+				close();
+
+#if defined(POML_HAS_MMAP)
+				const std::filesystem::path fs_path(path);
+
+				int fd = ::open(fs_path.c_str(), O_RDONLY);
+				if (fd < 0) {
+					return false;
+				}
+
+				struct stat st {};
+				if (::fstat(fd, &st) != 0) {
+					::close(fd);
+					return false;
+				}
+
+				if (st.st_size > 0) {
+					void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+					if (addr == MAP_FAILED) {
+						::close(fd);
+						return false;
+					}
+
+					::madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+					ptr = static_cast<const std::byte*>(addr);
+					len = static_cast<size_t>(st.st_size);
+					mapped = true;
+				}
+
+				::close(fd);
+				return true;
+#else
+				auto ifs = std::ifstream(path, std::ios::binary);
+				if (!ifs) {
+					return false;
+				}
+
+				bin = load_binary(path);
+				ptr = bin.data();
+				len = bin.size();
+				return true;
+#endif
+			}
+
+			void close() {
+#if defined(POML_HAS_MMAP)
+				if (mapped) {
+					::munmap(const_cast<std::byte*>(ptr), len);
+				}
+#endif
+				bin = {};
+				ptr = nullptr;
+				len = 0;
+				mapped = false;
+			}
+
+			const std::byte* data() const {
+				return ptr;
+			}
+
+			size_t size() const {
+				return len;
+			}
+
+		private:
+			const std::byte* ptr = nullptr;
+			size_t len = 0;
+			bool mapped = false;
+			std::vector<std::byte> bin{};
+		};
+
+		template<typename T>
+		inline T load(const std::byte* src) {
+			T dst;
+			std::memcpy(&dst, src, sizeof(T));
+			return dst;
+		}
+
+		// 0 means one per hardware thread.
+		inline unsigned resolve_num_threads(unsigned num_threads) {
+			if (num_threads == 0) {
+				num_threads = std::thread::hardware_concurrency();
+			}
+			return std::max(num_threads, 1u);
+		}
+
+		// Calls f(i) for every i in [0, count) on the calling thread and up to num_threads - 1 more.
+		// Indices are handed out one by one, so every call should be a chunk of work.
+		template<typename F>
+		inline void parallel_for(size_t count, unsigned num_threads, F&& f) {
+			const size_t num_workers = std::min<size_t>(num_threads, count);
+			if (num_workers <= 1) {
+				for (size_t i = 0; i < count; ++i) {
+					f(i);
+				}
+				return;
+			}
+
+			std::atomic<size_t> next = 0;
+			auto work = [&]() {
+				for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+					f(i);
+				}
+			};
+
+			std::vector<std::thread> threads;
+			threads.reserve(num_workers - 1);
+			for (size_t i = 1; i < num_workers; ++i) {
+				threads.emplace_back(work);
+			}
+
+			work();
+
+			for (auto& thread : threads) {
+				thread.join();
+			}
+		}
+
+		// Calls body(i) for every i in [0, count), possibly concurrently, and returns once every call is done.
+		// Lets the host run the loops of the importers on its own scheduler.
+		using Executor = std::function<void(size_t count, const std::function<void(size_t)>& body)>;
+
+		// Executor over parallel_for, starting up to num_threads - 1 threads per loop. 0 means one per hardware thread.
+		inline Executor make_thread_executor(unsigned num_threads) {
+			num_threads = resolve_num_threads(num_threads);
+			if (num_threads == 1) {
+				return {};
+			}
+
+			return [num_threads](size_t count, const std::function<void(size_t)>& body) {
+				parallel_for(count, num_threads, body);
+			};
+		}
+
+		// Runs the loop on executor, or on the calling thread without one.
+		template<typename F>
+		inline void parallel_for(const Executor& executor, size_t count, F&& f) {
+			if (!executor || count <= 1) {
+				for (size_t i = 0; i < count; ++i) {
+					f(i);
+				}
+				return;
+			}
+
+			executor(count, f);
+		}
+
+		// Flat open addressing table which groups fixed-size raw names without allocating per lookup.
+		// Bytes after the first NUL are ignored, as they are when the name is read as text.
+		template<size_t N>
+		class NameGroups {
+		public:
+			using Name = std::array<char, N>;
+
+			// Returns the group of the name at src, adding a new group on first sight.
+			uint32_t add(const std::byte* src) {
+				Name name{};
+				auto text = reinterpret_cast<const char*>(src);
+				std::memcpy(name.data(), text, strnlen_fixed(text));
+
+				if ((names.size() + 1) * 2 > slots.size()) {
+					rehash(std::max<size_t>(256, slots.size() * 2));
+				}
+
+				for (size_t i = hash(name) & (slots.size() - 1);; i = (i + 1) & (slots.size() - 1)) {
+					if (slots[i] == 0) {
+						names.push_back(name);
+						counts.push_back(1);
+						slots[i] = static_cast<uint32_t>(names.size());
+						return slots[i] - 1;
+					}
+					else if (names[slots[i] - 1] == name) {
+						++counts[slots[i] - 1];
+						return slots[i] - 1;
+					}
+				}
+			}
+
+			size_t size() const {
+				return names.size();
+			}
+
+			std::string_view text(uint32_t group) const {
+				return { names[group].data(), strnlen_fixed(names[group].data()) };
+			}
+
+			uint32_t count(uint32_t group) const {
+				return counts[group];
+			}
+
+		private:
+			std::vector<uint32_t> slots{}; // group + 1, or 0 if empty
+			std::vector<Name> names{};
+			std::vector<uint32_t> counts{};
+
+			static size_t strnlen_fixed(const char* text) {
+				auto nul = static_cast<const char*>(std::memchr(text, 0, N));
+				return nul ? static_cast<size_t>(nul - text) : N;
+			}
+
+			static size_t hash(const Name& name) {
+				uint64_t h = 14695981039346656037ull;
+				for (char c : name) {
+					h = (h ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+				}
+				return static_cast<size_t>(h ^ (h >> 32));
+			}
+
+			void rehash(size_t num_slots) {
+				slots.assign(num_slots, 0);
+
+				for (uint32_t group = 0; group < names.size(); ++group) {
+					size_t i = hash(names[group]) & (num_slots - 1);
+					while (slots[i] != 0) {
+						i = (i + 1) & (num_slots - 1);
+					}
+					slots[i] = group + 1;
+				}
+			}
+		};
+
 		template<typename Vec2, typename Vec3, typename Vec4>
 		struct PmxImporter {
 			using Pmx = PmxBase<Vec2, Vec3, Vec4>;
 
+			// Vertices decoded by one task.
+			static constexpr size_t ChunkSize = 8192;
+
 			Pmx& pmx;
 			io::BufferReader<void, 0> buff;
+			Executor executor;
 
-			PmxImporter(Pmx& pmx, const void* buff, size_t size) :
+			PmxImporter(Pmx& pmx, const void* buff, size_t size, Executor executor = {}) :
 				pmx(pmx),
-				buff(io::BufferReader<void, 0>{ (const std::byte*)buff, (const std::byte*)buff + size }) {}
+				buff(io::BufferReader<void, 0>{ (const std::byte*)buff, (const std::byte*)buff + size }),
+				executor(std::move(executor)) {}
 
 			bool is_valid_index_size(uint8_t index_size) {
 				switch (index_size) {
@@ -900,6 +2117,15 @@ namespace poml {
 				}
 			}
 
+			void read_text(typename Pmx::Text& text) {
+				if (pmx.encode == Pmx::Utf8) {
+					text << buff.as_text_utf8();
+				}
+				else {
+					text << buff.as_textw();
+				}
+			}
+
 			bool import_header() {
 				if (!buff.equal(Pmx::Magic) ||
 					!buff.equal(Pmx::Version) ||
@@ -907,7 +2133,7 @@ namespace poml {
 					return false;
 				}
 
-				uint8_t encode = buff.read_u8();
+				pmx.encode << buff;
 				pmx.num_ex_uvs << buff;
 				pmx.vertex_index_size << buff;
 				pmx.texture_index_size << buff;
@@ -916,7 +2142,7 @@ namespace poml {
 				pmx.morph_index_size << buff;
 				pmx.body_index_size << buff;
 
-				if (encode != 0 ||
+				if ((pmx.encode != Pmx::Utf16 && pmx.encode != Pmx::Utf8) ||
 					!is_valid_index_size(pmx.vertex_index_size) ||
 					!is_valid_index_size(pmx.texture_index_size) ||
 					!is_valid_index_size(pmx.material_index_size) ||
@@ -926,110 +2152,170 @@ namespace poml {
 					return false;
 				}
 
-				pmx.name << buff.as_textw();
-				pmx.name_en << buff.as_textw();
-				pmx.comment << buff.as_textw();
-				pmx.comment_en << buff.as_textw();
+				read_text(pmx.name);
+				read_text(pmx.name_en);
+				read_text(pmx.comment);
+				read_text(pmx.comment_en);
 
 				return !buff.is_overflown();
 			}
 
+			// The weight kind is known to be valid.
 			template<typename BoneIndex>
-			bool import_vertices() {
-				pmx.vertices.resize(buff.read_i32());
+			static void decode_vertex(io::RecordReader& buff, typename Pmx::Vertex& vertex, int num_ex_uvs) {
+				vertex.position << buff.as_vec3();
+				vertex.normal << buff.as_vec3();
+				vertex.uv << buff.as_vec2();
 
-				for (auto& vertex : pmx.vertices) {
-					vertex.position << buff.as_vec3();
-					vertex.normal << buff.as_vec3();
-					vertex.uv << buff.as_vec2();
+				for (int i = 0; i < num_ex_uvs; ++i) {
+					vertex.ex_uvs[i] << buff.as_vec4();
+				}
 
-					for (int i = 0; i < pmx.num_ex_uvs; ++i) {
-						vertex.ex_uvs[i] << buff.as_vec4();
-					}
+				switch (vertex.weight_kind << buff) {
+				case WeightKind::BDEF1:
+					vertex.bone_indices[0] << buff.as<BoneIndex>();
+					vertex.bone_indices[1] = -1;
+					vertex.bone_indices[2] = -1;
+					vertex.bone_indices[3] = -1;
+
+					vertex.bone_weights[0] = 1.f;
+					vertex.bone_weights[1] = 0.f;
+					vertex.bone_weights[2] = 0.f;
+					vertex.bone_weights[3] = 0.f;
+					break;
+
+				case WeightKind::BDEF2:
+					vertex.bone_indices[0] << buff.as<BoneIndex>();
+					vertex.bone_indices[1] << buff.as<BoneIndex>();
+					vertex.bone_indices[2] = -1;
+					vertex.bone_indices[3] = -1;
+
+					vertex.bone_weights[0] << buff;
+					vertex.bone_weights[1] = 1.f - vertex.bone_weights[0];
+					vertex.bone_weights[2] = 0.f;
+					vertex.bone_weights[3] = 0.f;
+					break;
+
+				case WeightKind::BDEF4:
+					vertex.bone_indices[0] << buff.as<BoneIndex>();
+					vertex.bone_indices[1] << buff.as<BoneIndex>();
+					vertex.bone_indices[2] << buff.as<BoneIndex>();
+					vertex.bone_indices[3] << buff.as<BoneIndex>();
+
+					vertex.bone_weights[0] << buff;
+					vertex.bone_weights[1] << buff;
+					vertex.bone_weights[2] << buff;
+					vertex.bone_weights[3] << buff;
+					break;
+
+				case WeightKind::SDEF:
+					vertex.bone_indices[0] << buff.as<BoneIndex>();
+					vertex.bone_indices[1] << buff.as<BoneIndex>();
+					vertex.bone_indices[2] = -1;
+					vertex.bone_indices[3] = -1;
+
+					vertex.bone_weights[0] << buff;
+					vertex.bone_weights[1] = 0.f;
+					vertex.bone_weights[2] = 0.f;
+					vertex.bone_weights[3] = 0.f;
+
+					vertex.sdef_c << buff.as_vec3();
+					vertex.sdef_r0 << buff.as_vec3();
+					vertex.sdef_r1 << buff.as_vec3();
+					break;
+				}
 
-					switch (vertex.weight_kind << buff) {
-					case WeightKind::BDEF1:
-						vertex.bone_indices[0] << buff.as<BoneIndex>();
-						vertex.bone_indices[1] = -1;
-						vertex.bone_indices[2] = -1;
-						vertex.bone_indices[3] = -1;
-
-						vertex.bone_weights[0] = 1.f;
-						vertex.bone_weights[1] = 0.f;
-						vertex.bone_weights[2] = 0.f;
-						vertex.bone_weights[3] = 0.f;
-						break;
+				vertex.edge << buff;
+			}
 
-					case WeightKind::BDEF2:
-						vertex.bone_indices[0] << buff.as<BoneIndex>();
-						vertex.bone_indices[1] << buff.as<BoneIndex>();
-						vertex.bone_indices[2] = -1;
-						vertex.bone_indices[3] = -1;
-
-						vertex.bone_weights[0] << buff;
-						vertex.bone_weights[1] = 1.f - vertex.bone_weights[0];
-						vertex.bone_weights[2] = 0.f;
-						vertex.bone_weights[3] = 0.f;
-						break;
+			// Records differ in size by weight kind, so a scan over the kinds first sums up the record sizes
+			// to locate every chunk and checks the bounds of the whole section. Chunks are then decoded in parallel
+			// with unchecked loads.
+			template<typename BoneIndex>
+			bool import_vertices() {
+				constexpr size_t B = sizeof(BoneIndex);
+				constexpr size_t weight_sizes[] = {
+					B,					// BDEF1
+					2 * B + 4,			// BDEF2
+					4 * B + 16,			// BDEF4
+					2 * B + 4 + 36,		// SDEF
+				};
 
-					case WeightKind::BDEF4:
-						vertex.bone_indices[0] << buff.as<BoneIndex>();
-						vertex.bone_indices[1] << buff.as<BoneIndex>();
-						vertex.bone_indices[2] << buff.as<BoneIndex>();
-						vertex.bone_indices[3] << buff.as<BoneIndex>();
-
-						vertex.bone_weights[0] << buff;
-						vertex.bone_weights[1] << buff;
-						vertex.bone_weights[2] << buff;
-						vertex.bone_weights[3] << buff;
-						break;
+				// Position, normal, uv and ex uvs.
+				const size_t fixed_size = 32 + 16 * pmx.num_ex_uvs;
 
-					case WeightKind::SDEF:
-						vertex.bone_indices[0] << buff.as<BoneIndex>();
-						vertex.bone_indices[1] << buff.as<BoneIndex>();
-						vertex.bone_indices[2] = -1;
-						vertex.bone_indices[3] = -1;
-
-						vertex.bone_weights[0] << buff;
-						vertex.bone_weights[1] = 0.f;
-						vertex.bone_weights[2] = 0.f;
-						vertex.bone_weights[3] = 0.f;
-
-						vertex.sdef_c << buff.as_vec3();
-						vertex.sdef_r0 << buff.as_vec3();
-						vertex.sdef_r1 << buff.as_vec3();
-						break;
+				const size_t num_vertices = buff.read_count(fixed_size + 1 + weight_sizes[0] + 4);
+				if (buff.is_overflown()) {
+					return false;
+				}
 
-					default:
+				const size_t num_chunks = (num_vertices + ChunkSize - 1) / ChunkSize;
+				std::vector<const std::byte*> chunk_starts(num_chunks + 1);
+
+				auto ptr = buff.ptr;
+				for (size_t i = 0; i < num_vertices; ++i) {
+					if (i % ChunkSize == 0) {
+						chunk_starts[i / ChunkSize] = ptr;
+					}
+
+					if (static_cast<size_t>(buff.end - ptr) <= fixed_size) {
 						return false;
 					}
 
-					vertex.edge << buff;
+					const auto kind = static_cast<uint8_t>(ptr[fixed_size]);
+					if (kind >= std::size(weight_sizes)) {
+						return false;
+					}
+
+					const size_t size = fixed_size + 1 + weight_sizes[kind] + 4;
+					if (static_cast<size_t>(buff.end - ptr) < size) {
+						return false;
+					}
+					ptr += size;
 				}
 
-				return !buff.is_overflown();
+				chunk_starts[num_chunks] = ptr;
+				buff.ptr = ptr;
+
+				pmx.vertices.resize(num_vertices);
+
+				parallel_for(executor, num_chunks, [&](size_t chunk) {
+					io::RecordReader reader{ chunk_starts[chunk], chunk_starts[chunk + 1] };
+					for (size_t i = chunk * ChunkSize, last = std::min(i + ChunkSize, num_vertices); i < last; ++i) {
+						decode_vertex<BoneIndex>(reader, pmx.vertices[i], pmx.num_ex_uvs);
+					}
+				});
+
+				return true;
 			}
 
 			template<typename VertexIndex>
 			bool import_faces() {
-				pmx.faces.resize(buff.read_i32());
+				const int32_t num_faces = buff.read_i32();
+				if (num_faces < 0 || num_faces % 3 != 0) {
+					return false;
+				}
 
-				if (pmx.faces.size() % 3 != 0) {
+				auto indices = buff.take(num_faces, sizeof(VertexIndex));
+				if (!indices) {
 					return false;
 				}
 
+				pmx.faces.resize(num_faces);
+
+				io::RecordReader reader{ indices, indices + num_faces * sizeof(VertexIndex) };
 				for (auto& index : pmx.faces) {
-					index << buff.as<VertexIndex>();
+					index << reader.as<VertexIndex>();
 				}
 
 				return !buff.is_overflown();
 			}
 
 			bool import_textures() {
-				pmx.textures.resize(buff.read_i32());
+				pmx.textures.resize(buff.read_count(4));
 
 				for (auto& texture : pmx.textures) {
-					texture << buff.as_textw();
+					read_text(texture);
 				}
 
 				return !buff.is_overflown();
@@ -1037,11 +2323,11 @@ namespace poml {
 
 			template<typename TextureIndex>
 			bool import_materials() {
-				pmx.materials.resize(buff.read_i32());
+				pmx.materials.resize(buff.read_count(84 + 2 * sizeof(TextureIndex)));
 
 				for (auto& material : pmx.materials) {
-					material.name << buff.as_textw();
-					material.name_en << buff.as_textw();
+					read_text(material.name);
+					read_text(material.name_en);
 					material.diffuse << buff.as_vec4();
 					material.specular << buff.as_vec4();
 					material.ambient << buff.as_vec3();
@@ -1065,7 +2351,7 @@ namespace poml {
 					else {
 						material.toon_texture_index << buff.as<TextureIndex>();
 					}
-					material.note << buff.as_textw();
+					read_text(material.note);
 					material.num_vertices << buff;
 
 					if (material.num_vertices % 3 != 0) {
@@ -1078,11 +2364,11 @@ namespace poml {
 
 			template<typename BoneIndex>
 			bool import_bones() {
-				pmx.bones.resize(buff.read_i32());
+				pmx.bones.resize(buff.read_count(26 + 2 * sizeof(BoneIndex)));
 
 				for (auto& bone : pmx.bones) {
-					bone.name << buff.as_textw();
-					bone.name_en << buff.as_textw();
+					read_text(bone.name);
+					read_text(bone.name_en);
 					bone.position << buff.as_vec3();
 					bone.parent_bone_index << buff.as<BoneIndex>();
 					bone.level << buff;
@@ -1148,7 +2434,7 @@ namespace poml {
 						bone.ik_iteration_count << buff;
 						bone.ik_angle_limit << buff;
 
-						bone.ik_links.resize(buff.read_i32());
+						bone.ik_links.resize(buff.read_count(1 + sizeof(BoneIndex)));
 
 						for (auto& ik_link : bone.ik_links) {
 							ik_link.index << buff.as<BoneIndex>();
@@ -1169,8 +2455,8 @@ namespace poml {
 			}
 
 			template<typename VertexIndex>
-			void import_vertex_morph(const std::wstring& name, const std::wstring& name_en, MorphPanel panel) {
-				std::vector<Pmx::VertexMorphData> morph_data(buff.read_i32());
+			void import_vertex_morph(const typename Pmx::Text& name, const typename Pmx::Text& name_en, MorphPanel panel) {
+				std::vector<typename Pmx::VertexMorphData> morph_data(buff.read_count(sizeof(VertexIndex) + 12));
 
 				for (auto& data : morph_data) {
 					data.index << buff.as<VertexIndex>();
@@ -1181,8 +2467,8 @@ namespace poml {
 			}
 
 			template<typename VertexIndex>
-			void import_uv_morph(const std::wstring& name, const std::wstring& name_en, MorphPanel panel, MorphKind kind) {
-				std::vector<Pmx::UvMorphData> morph_data(buff.read_i32());
+			void import_uv_morph(const typename Pmx::Text& name, const typename Pmx::Text& name_en, MorphPanel panel, MorphKind kind) {
+				std::vector<typename Pmx::UvMorphData> morph_data(buff.read_count(sizeof(VertexIndex) + 16));
 
 				for (auto& data : morph_data) {
 					data.index << buff.as<VertexIndex>();
@@ -1193,8 +2479,8 @@ namespace poml {
 			}
 
 			template<typename BoneIndex>
-			void import_bone_morph(const std::wstring& name, const std::wstring& name_en, MorphPanel panel) {
-				std::vector<Pmx::BoneMorphData> morph_data(buff.read_i32());
+			void import_bone_morph(const typename Pmx::Text& name, const typename Pmx::Text& name_en, MorphPanel panel) {
+				std::vector<typename Pmx::BoneMorphData> morph_data(buff.read_count(sizeof(BoneIndex) + 28));
 
 				for (auto& data : morph_data) {
 					data.index << buff.as<BoneIndex>();
@@ -1206,15 +2492,15 @@ namespace poml {
 			}
 
 			template<typename MaterialIndex>
-			void import_material_morph(const std::wstring& name, const std::wstring& name_en, MorphPanel panel) {
-				std::vector<Pmx::MaterialMorphData> morph_data(buff.read_i32());
+			void import_material_morph(const typename Pmx::Text& name, const typename Pmx::Text& name_en, MorphPanel panel) {
+				std::vector<typename Pmx::MaterialMorphData> morph_data(buff.read_count(sizeof(MaterialIndex) + 113));
 
 				for (auto& data : morph_data) {
 					data.index << buff.as<MaterialIndex>();
 					data.op << buff;
 					data.diffuse << buff.as_vec4();
 					data.specular << buff.as_vec4();
-					data.ambient << buff.as_vec4();
+					data.ambient << buff.as_vec3();
 					data.edge_color << buff.as_vec4();
 					data.edge_size << buff;
 					data.tex << buff.as_vec4();
@@ -1226,8 +2512,8 @@ namespace poml {
 			}
 
 			template<typename MorphIndex>
-			void import_group_morph(std::wstring& name, std::wstring& name_en, MorphPanel panel) {
-				std::vector<Pmx::GroupMorphData> morph_data(buff.read_i32());
+			void import_group_morph(const typename Pmx::Text& name, const typename Pmx::Text& name_en, MorphPanel panel) {
+				std::vector<typename Pmx::GroupMorphData> morph_data(buff.read_count(sizeof(MorphIndex) + 4));
 
 				for (auto& data : morph_data) {
 					data.index << buff.as<MorphIndex>();
@@ -1240,16 +2526,21 @@ namespace poml {
 			bool import_morphs() {
 				const int32_t num_morphs = buff.read_i32();
 
-				std::wstring name{}, name_en{};
+				typename Pmx::Text name{}, name_en{};
 				MorphPanel panel{};
 				MorphKind kind{};
 
 				for (int i = 0; i < num_morphs; ++i) {
-					name << buff.as_textw();
-					name_en << buff.as_textw();
+					read_text(name);
+					read_text(name_en);
 					panel = buff.read<MorphPanel>();
 					kind = buff.read<MorphKind>();
 
+					// Stop early on a count that does not match the data.
+					if (buff.is_overflown()) {
+						return false;
+					}
+
 					switch (kind) {
 					case MorphKind::Group:
 						switch (pmx.morph_index_size) {
@@ -1302,15 +2593,15 @@ namespace poml {
 
 			template<typename BoneIndex, typename MorphIndex>
 			bool import_nodes() {
-				pmx.nodes.resize(buff.read_i32());
+				pmx.nodes.resize(buff.read_count(13));
 
 				for (auto& node : pmx.nodes) {
-					node.name << buff.as_textw();
-					node.name_en << buff.as_textw();
+					read_text(node.name);
+					read_text(node.name_en);
 
 					node.special << buff;
 
-					node.items.resize(buff.read_i32());
+					node.items.resize(buff.read_count(1 + std::min(sizeof(BoneIndex), sizeof(MorphIndex))));
 					for (auto& item : node.items) {
 						switch (item.kind << buff) {
 						case NodeKind::Bone: item.index << buff.as<BoneIndex>(); break;
@@ -1325,11 +2616,11 @@ namespace poml {
 
 			template<typename BoneIndex>
 			bool import_bodies() {
-				pmx.bodies.resize(buff.read_i32());
+				pmx.bodies.resize(buff.read_count(69 + sizeof(BoneIndex)));
 
 				for (auto& body : pmx.bodies) {
-					body.name << buff.as_textw();
-					body.name_en << buff.as_textw();
+					read_text(body.name);
+					read_text(body.name_en);
 					body.index << buff.as<BoneIndex>();
 					body.group << buff;
 					body.pass_group << buff;
@@ -1350,11 +2641,11 @@ namespace poml {
 
 			template<typename BodyIndex>
 			bool import_joints() {
-				pmx.joints.resize(buff.read_i32());
+				pmx.joints.resize(buff.read_count(105 + 2 * sizeof(BodyIndex)));
 
 				for (auto& joint : pmx.joints) {
-					joint.name << buff.as_textw();
-					joint.name_en << buff.as_textw();
+					read_text(joint.name);
+					read_text(joint.name_en);
 
 					switch (joint.kind << buff) {
 					case JointKind::Spring6DOF:
@@ -1857,7 +3148,8 @@ namespace poml {
 				return true;
 			}
 
-			bool export_pmx() {
+			// Writes every section through buff, which counts or stores the bytes depending on its mode.
+			bool export_sections() {
 				bool ret = export_header();
 				if (ret) ret = export_vertices();
 				if (ret) ret = export_faces();
@@ -1871,18 +3163,58 @@ namespace poml {
 
 				return ret;
 			}
+
+			// Exact size of the image.
+			size_t measure() {
+				buff.measure();
+				export_sections();
+				return buff.size();
+			}
+
+			// Writes the image into dst, which must be measure() bytes.
+			bool export_to(std::byte* dst, size_t size) {
+				buff.attach(dst, size);
+				return export_sections() && !buff.is_overflown() && buff.size() == size;
+			}
+
+			// Streams the image to sink in chunks of chunk_size bytes.
+			bool export_to(const Sink& sink, size_t chunk_size = BufferWriterBase::DefaultChunkSize) {
+				buff.stream(sink, chunk_size);
+				const bool ret = export_sections();
+				return buff.finish() && ret;
+			}
+
+			// Writes the image into buff, allocated once with the measured size.
+			bool export_pmx() {
+				const size_t size = measure();
+				buff.allocate(size);
+				return export_to(buff.storage.get(), size);
+			}
 		};
 
 		template<typename Vec3, typename Vec4>
 		struct VmdImporter {
 			using Vmd = VmdBase<Vec3, Vec4>;
 
+			static constexpr size_t MotionSize = 111;
+			static constexpr size_t MorphSize = 23;
+			static constexpr size_t CameraSize = 61;
+			static constexpr size_t LightSize = 28;
+			static constexpr size_t ShadowSize = 9;
+			static constexpr size_t ExKeySize = 9;
+			static constexpr size_t ExIkSize = 21;
+
+			// Keys of a named section decoded by one task.
+			static constexpr size_t ChunkSize = 16384;
+
 			Vmd& vmd;
 			io::BufferReader<void, 0> buff;
+			Executor executor;
 
-			VmdImporter(Vmd& vmd, const void* data, size_t size) :
+			VmdImporter(Vmd& vmd, const void* data, size_t size, Executor executor = {}) :
 				vmd(vmd),
-				buff(io::BufferReader<void, 0> { (const std::byte*)data, (const std::byte*)data + size }) {}
+				buff(io::BufferReader<void, 0> { (const std::byte*)data, (const std::byte*)data + size }),
+				executor(std::move(executor)) {}
 
 			bool import_header() {
 				if (!buff.equal(Vmd::Magic)) {
@@ -1894,37 +3226,161 @@ namespace poml {
 				return !buff.is_overflown();
 			}
 
-			bool import_motions() {
-				for (uint32_t i = 0, num_keys = buff.read_u32(); i < num_keys; ++i) {
-					auto name = buff.read_texta<15>();
-					auto& key = vmd.motion_tracks[name].add();
-					key.frame << buff;
-					key.position << buff.as_vec3();
-					key.orientation << buff.as_vec4();
-					key.interpolation << buff;
-					key.ix.x1 = key.interpolation[0 + 0];	key.ix.y1 = key.interpolation[0 + 4];	key.ix.x2 = key.interpolation[0 + 8];	key.ix.y2 = key.interpolation[0 + 12];
-					key.iy.x1 = key.interpolation[16 + 0];	key.iy.y1 = key.interpolation[16 + 4];	key.iy.x2 = key.interpolation[16 + 8];	key.iy.y2 = key.interpolation[16 + 12];
-					key.iz.x1 = key.interpolation[32 + 0];	key.iz.y1 = key.interpolation[32 + 4];	key.iz.x2 = key.interpolation[32 + 8];	key.iz.y2 = key.interpolation[32 + 12];
-					key.ir.x1 = key.interpolation[48 + 0];	key.ir.y1 = key.interpolation[48 + 4];	key.ir.x2 = key.interpolation[48 + 8];	key.ir.y2 = key.interpolation[48 + 12];
-					key.is_physics = !(key.interpolation[2] == 0x63 && key.interpolation[3] == 0x0f);
+			// Groups the fixed-size records of a section by name: count the keys of each name, size every track
+			// exactly, then decode the records in chunks. Every chunk owns a slot range of each track, placed after
+			// the ranges of the chunks before it, so chunks are decoded in parallel and keep the record order.
+			// Names are converted to text once per track. Only tracks whose keys arrived out of frame order are sorted.
+			template<size_t NameSize, size_t RecordSize, typename Tracks>
+			struct NamedRecords {
+				using Track = typename Tracks::mapped_type;
+
+				const std::byte* records = nullptr;
+				size_t num_keys = 0;
+				size_t num_chunks = 0;
+				std::vector<uint32_t> record_groups;
+				std::vector<size_t> chunk_slots; // slot of the next key of each group in each chunk
+				std::vector<Track*> group_tracks;
+
+				// Takes the records from buff, groups them and sizes every track. Runs on one thread.
+				bool prepare(io::BufferReader<void, 0>& buff, Tracks& tracks) {
+					num_keys = buff.read_u32();
+					records = buff.take(num_keys, RecordSize);
+					if (!records) {
+						return false;
+					}
+
+					NameGroups<NameSize> groups;
+					record_groups.resize(num_keys);
+					for (size_t i = 0; i < num_keys; ++i) {
+						record_groups[i] = groups.add(records + i * RecordSize);
+					}
+
+					const size_t num_groups = groups.size();
+					num_chunks = (num_keys + ChunkSize - 1) / ChunkSize;
+
+					chunk_slots.assign(num_chunks * num_groups, 0);
+					for (size_t i = 0; i < num_keys; ++i) {
+						++chunk_slots[i / ChunkSize * num_groups + record_groups[i]];
+					}
+
+					group_tracks.resize(num_groups);
+					for (uint32_t group = 0; group < num_groups; ++group) {
+						auto& track = tracks[typename Tracks::key_type(groups.text(group))];
+						group_tracks[group] = &track;
+
+						size_t slot = track.size();
+						for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+							auto& chunk_slot = chunk_slots[chunk * num_groups + group];
+							const size_t count = chunk_slot;
+							chunk_slot = slot;
+							slot += count;
+						}
+						track.resize(slot);
+					}
+
+					return true;
 				}
 
-				for (auto& [name, track] : vmd.motion_tracks) {
-					track.sort();
+				size_t num_groups() const {
+					return group_tracks.size();
 				}
 
-				return !buff.is_overflown();
+				template<typename Decode>
+				void decode_chunk(size_t chunk, Decode&& decode) {
+					auto slots = chunk_slots.data() + chunk * num_groups();
+					for (size_t i = chunk * ChunkSize, last = std::min(i + ChunkSize, num_keys); i < last; ++i) {
+						auto record = records + i * RecordSize;
+						io::RecordReader reader{ record + NameSize, record + RecordSize };
+
+						const uint32_t group = record_groups[i];
+						decode(reader, group_tracks[group]->keys[slots[group]++]);
+					}
+				}
+
+				void sort_group(size_t group) {
+					group_tracks[group]->sort();
+				}
+			};
+
+			using MotionRecords = NamedRecords<15, MotionSize, decltype(Vmd::motion_tracks)>;
+			using MorphRecords = NamedRecords<15, MorphSize, decltype(Vmd::morph_tracks)>;
+
+			template<size_t NameSize, size_t RecordSize, typename Tracks, typename Decode>
+			bool import_named_records(Tracks& tracks, Decode&& decode) {
+				NamedRecords<NameSize, RecordSize, Tracks> section;
+				if (!section.prepare(buff, tracks)) {
+					return false;
+				}
+
+				parallel_for(executor, section.num_chunks, [&](size_t chunk) {
+					section.decode_chunk(chunk, decode);
+				});
+
+				// Sorting is rare, so a single chunk is not worth spreading over the executor.
+				parallel_for(section.num_chunks > 1 ? executor : Executor{}, section.num_groups(), [&](size_t group) {
+					section.sort_group(group);
+				});
+
+				return true;
 			}
 
-			bool import_morphs() {
-				for (uint32_t i = 0, num_keys = buff.read_u32(); i < num_keys; ++i) {
-					auto name = buff.read_texta<15>();
-					auto& key = vmd.morph_tracks[name].add();
-					key.frame << buff;
-					key.value << buff;
+			// Checks a section of fixed-size records at once, then decodes them with unchecked loads.
+			// The track is only sorted when the keys arrived out of frame order.
+			template<size_t RecordSize, typename Track, typename Decode>
+			bool import_records(Track& track, Decode&& decode) {
+				const uint32_t num_keys = buff.read_u32();
+				const std::byte* records = buff.take(num_keys, RecordSize);
+				if (!records) {
+					return false;
+				}
+
+				track.resize(num_keys);
+
+				bool sorted = true;
+				uint32_t prev_frame = 0;
+
+				for (uint32_t i = 0; i < num_keys; ++i) {
+					auto record = records + i * RecordSize;
+					io::RecordReader reader{ record, record + RecordSize };
+
+					auto& key = track.keys[i];
+					decode(reader, key);
+
+					sorted = sorted && prev_frame <= key.frame;
+					prev_frame = key.frame;
+				}
+
+				if (!sorted) {
+					track.sort();
 				}
 
-				// Remove unused track.
+				return true;
+			}
+
+			static constexpr auto decode_motion = [](auto& buff, auto& key) {
+				key.frame << buff;
+				key.position << buff.as_vec3();
+				key.orientation << buff.as_vec4();
+				key.interpolation << buff;
+				key.ix.x1 = key.interpolation[0 + 0];	key.ix.y1 = key.interpolation[0 + 4];	key.ix.x2 = key.interpolation[0 + 8];	key.ix.y2 = key.interpolation[0 + 12];
+				key.iy.x1 = key.interpolation[16 + 0];	key.iy.y1 = key.interpolation[16 + 4];	key.iy.x2 = key.interpolation[16 + 8];	key.iy.y2 = key.interpolation[16 + 12];
+				key.iz.x1 = key.interpolation[32 + 0];	key.iz.y1 = key.interpolation[32 + 4];	key.iz.x2 = key.interpolation[32 + 8];	key.iz.y2 = key.interpolation[32 + 12];
+				key.ir.x1 = key.interpolation[48 + 0];	key.ir.y1 = key.interpolation[48 + 4];	key.ir.x2 = key.interpolation[48 + 8];	key.ir.y2 = key.interpolation[48 + 12];
+				key.is_physics = !(key.interpolation[2] == 0x63 && key.interpolation[3] == 0x0f);
+			};
+
+			static constexpr auto decode_morph = [](auto& buff, auto& key) {
+				key.frame << buff;
+				key.value << buff;
+			};
+
+			bool import_motions() {
+				bool ret = import_named_records<15, MotionSize>(vmd.motion_tracks, decode_motion);
+
+				return ret && !buff.is_overflown();
+			}
+
+			void remove_unused_morph_tracks() {
 				for (auto it = vmd.morph_tracks.begin(); it != vmd.morph_tracks.end();) {
 					auto& keys = it->second;
 
@@ -1935,18 +3391,18 @@ namespace poml {
 						++it;
 					}
 				}
+			}
 
-				for (auto& [name, track] : vmd.morph_tracks) {
-					track.sort();
-				}
+			bool import_morphs() {
+				bool ret = import_named_records<15, MorphSize>(vmd.morph_tracks, decode_morph);
 
-				return !buff.is_overflown();
+				remove_unused_morph_tracks();
+
+				return ret && !buff.is_overflown();
 			}
 
 			bool import_cameras() {
-				vmd.camera_track.resize(buff.read_u32());
-
-				for (auto& key : vmd.camera_track) {
+				bool ret = import_records<CameraSize>(vmd.camera_track, [](auto& buff, auto& key) {
 					key.frame << buff;
 					key.distance << buff;
 					key.position << buff.as_vec3();
@@ -1959,61 +3415,75 @@ namespace poml {
 					key.iv << buff;
 					key.view_angle << buff;
 					key.orthographic << buff;
-				}
+				});
 
-				vmd.camera_track.sort();
-
-				return !buff.is_overflown();
+				return ret && !buff.is_overflown();
 			}
 
 			bool import_lights() {
-				vmd.light_track.resize(buff.read_u32());
-
-				for (auto& key : vmd.light_track) {
+				bool ret = import_records<LightSize>(vmd.light_track, [](auto& buff, auto& key) {
 					key.frame << buff;
 					key.color << buff.as_vec3();
 					key.position << buff.as_vec3();
-				}
+				});
 
-				vmd.light_track.sort();
-
-				return !buff.is_overflown();
+				return ret && !buff.is_overflown();
 			}
 
 			bool import_shadows() {
-				vmd.shadow_track.resize(buff.read_u32());
-
-				for (auto& key : vmd.shadow_track) {
+				bool ret = import_records<ShadowSize>(vmd.shadow_track, [](auto& buff, auto& key) {
 					key.frame << buff;
 					key.type << buff;
 					key.distance << buff;
-				}
-
-				vmd.shadow_track.sort();
+				});
 
-				return !buff.is_overflown();
+				return ret && !buff.is_overflown();
 			}
 
 			bool import_ex_keys() {
+				// Every ik track receives its keys in record order, so it is ordered whenever the records are.
+				bool sorted = true;
+				uint32_t prev_frame = 0;
+				typename Vmd::Text ik_name;
+
 				for (uint32_t i = 0, num_keys = buff.read_u32(); i < num_keys; ++i) {
-					uint32_t frame = buff.read_u32();
+					auto record = buff.take(1, ExKeySize);
+					if (!record) {
+						return false;
+					}
+
+					io::RecordReader reader{ record, record + ExKeySize };
+					const uint32_t frame = reader.read_u32();
+
+					sorted = sorted && prev_frame <= frame;
+					prev_frame = frame;
 
 					auto& visibility_key = vmd.visibility_track.add();
 					visibility_key.frame = frame;
-					visibility_key.visible << buff;
+					visibility_key.visible << reader;
+
+					const uint32_t num_iks = reader.read_u32();
+					auto iks = buff.take(num_iks, ExIkSize);
+					if (!iks) {
+						return false;
+					}
+
+					for (uint32_t j = 0; j < num_iks; ++j) {
+						io::RecordReader ik{ iks + j * ExIkSize, iks + (j + 1) * ExIkSize };
+						ik_name << ik.as_texta<20>();
 
-					for (uint32_t j = 0, num_iks = buff.read_u32(); j < num_iks; ++j) {
-						auto name = buff.read_texta<20>();
-						auto& ik_key = vmd.ik_tracks[name].add();
+						auto& ik_key = vmd.ik_tracks[ik_name].add();
 						ik_key.frame = frame;
-						ik_key.enable << buff;
+						ik_key.enable << ik;
 					}
 				}
 
-				vmd.visibility_track.sort();
+				if (!sorted) {
+					vmd.visibility_track.sort();
 
-				for (auto& [name, track] : vmd.ik_tracks) {
-					track.sort();
+					for (auto& [name, track] : vmd.ik_tracks) {
+						track.sort();
+					}
 				}
 
 				return !buff.is_overflown();
@@ -2030,6 +3500,131 @@ namespace poml {
 
 				return ret && buff.is_eof() && !buff.is_overflown();
 			}
+
+			// Start of every section after the header, and the end of the file.
+			using Sections = std::array<const std::byte*, 7>;
+
+			// Locates the sections from their counts without decoding them.
+			bool scan_sections(Sections& sections) const {
+				constexpr size_t record_sizes[] = { MotionSize, MorphSize, CameraSize, LightSize, ShadowSize };
+
+				auto ptr = buff.ptr;
+				auto end = buff.end;
+
+				for (size_t i = 0; i < std::size(record_sizes); ++i) {
+					sections[i] = ptr;
+
+					if (end - ptr < 4) {
+						return false;
+					}
+
+					size_t count = load<uint32_t>(ptr);
+					if (static_cast<size_t>(end - ptr - 4) / record_sizes[i] < count) {
+						return false;
+					}
+					ptr += 4 + count * record_sizes[i];
+				}
+
+				sections[5] = ptr;
+
+				if (end - ptr < 4) {
+					return false;
+				}
+
+				size_t count = load<uint32_t>(ptr);
+				ptr += 4;
+
+				for (size_t i = 0; i < count; ++i) {
+					if (static_cast<size_t>(end - ptr) < ExKeySize) {
+						return false;
+					}
+
+					size_t num_iks = load<uint32_t>(ptr + 5);
+					ptr += ExKeySize;
+
+					if (static_cast<size_t>(end - ptr) / ExIkSize < num_iks) {
+						return false;
+					}
+					ptr += num_iks * ExIkSize;
+				}
+
+				sections[6] = ptr;
+				return ptr == end;
+			}
+
+			// Same result as import_vmd. The sections are located by an offset scan first, then run as tasks on
+			// the executor: the small sections are decoded whole while motions and morphs are only grouped.
+			// The chunks of both named sections follow in one loop, and their tracks are sorted in another,
+			// so that loops never nest.
+			bool import_vmd_parallel() {
+				Sections sections;
+				if (!import_header() || !scan_sections(sections)) {
+					return false;
+				}
+
+				using Import = bool (VmdImporter::*)();
+				constexpr Import imports[] = {
+					nullptr,
+					nullptr,
+					&VmdImporter::import_cameras,
+					&VmdImporter::import_lights,
+					&VmdImporter::import_shadows,
+					&VmdImporter::import_ex_keys,
+				};
+
+				MotionRecords motions;
+				MorphRecords morphs;
+
+				// Sections write disjoint members of vmd.
+				bool results[std::size(imports)] = {};
+				parallel_for(executor, std::size(imports), [&](size_t i) {
+					VmdImporter section(vmd, sections[i], sections[i + 1] - sections[i]);
+
+					bool ret = false;
+					switch (i) {
+					case 0:
+						ret = motions.prepare(section.buff, vmd.motion_tracks);
+						break;
+					case 1:
+						ret = morphs.prepare(section.buff, vmd.morph_tracks);
+						break;
+					default:
+						ret = (section.*imports[i])();
+						break;
+					}
+
+					results[i] = ret && section.buff.is_eof() && !section.buff.is_overflown();
+				});
+
+				if (!std::ranges::all_of(results, [](bool result) { return result; })) {
+					return false;
+				}
+
+				parallel_for(executor, motions.num_chunks + morphs.num_chunks, [&](size_t chunk) {
+					if (chunk < motions.num_chunks) {
+						motions.decode_chunk(chunk, decode_motion);
+					}
+					else {
+						morphs.decode_chunk(chunk - motions.num_chunks, decode_morph);
+					}
+				});
+
+				// Sorting is rare, so single chunks are not worth spreading over the executor.
+				const bool is_large = motions.num_chunks > 1 || morphs.num_chunks > 1;
+				parallel_for(is_large ? executor : Executor{}, motions.num_groups() + morphs.num_groups(), [&](size_t group) {
+					if (group < motions.num_groups()) {
+						motions.sort_group(group);
+					}
+					else {
+						morphs.sort_group(group - motions.num_groups());
+					}
+				});
+
+				remove_unused_morph_tracks();
+
+				buff.ptr = buff.end;
+				return true;
+			}
 		};
 
 		template<typename Vec3, typename Vec4>
@@ -2146,41 +3741,120 @@ namespace poml {
 				return true;
 			}
 
+			// Merges the visibility track and the ik tracks by frame. Of several keys at one frame of a track
+			// the last one wins, and a frame without a visibility key is visible. The iks of a frame keep the
+			// name order of ik_tracks. The frames are counted in a first pass, as their count comes first.
 			bool export_ex_keys() {
-				struct ExKey {
-					bool visible = true;
-					std::map<typename Vmd::Text, bool> iks;
+				using VisibilityKey = typename Vmd::VisibilityKey;
+				using IkKey = typename Vmd::IkKey;
+
+				struct IkCursor {
+					std::array<char, 20> name;
+					std::span<const IkKey> keys;
+					size_t next;
 				};
-				std::map<uint32_t, ExKey> ex_keys{}; // frame - ex_key map
 
-				// Integrate visibility and ik keys
-				{
-					for (auto& key : vmd.visibility_track) {
-						ex_keys[key.frame].visible = key.visible;
+				auto by_frame = [](const auto& key0, const auto& key1) { return key0.frame < key1.frame; };
+
+				// Tracks out of frame order are merged from stably sorted copies.
+				std::vector<VisibilityKey> visibility_copy;
+				std::span<const VisibilityKey> visibility = vmd.visibility_track.keys;
+				if (!std::is_sorted(visibility.begin(), visibility.end(), by_frame)) {
+					visibility_copy.assign(visibility.begin(), visibility.end());
+					std::stable_sort(visibility_copy.begin(), visibility_copy.end(), by_frame);
+					visibility = visibility_copy;
+				}
+
+				std::vector<IkCursor> iks;
+				std::vector<std::vector<IkKey>> ik_copies;
+				iks.reserve(vmd.ik_tracks.size());
+				ik_copies.reserve(vmd.ik_tracks.size());
+
+				for (auto& [name, track] : vmd.ik_tracks) {
+					if (track.empty()) {
+						continue;
 					}
 
-					for (auto& [name, track] : vmd.ik_tracks) {
-						for (auto& key : track) {
-							ex_keys[key.frame].iks[name] = key.enable;
-						}
+					auto& ik = iks.emplace_back();
+					std::memcpy(ik.name.data(), name.data(), std::min(name.size(), ik.name.size()));
+					ik.keys = track.keys;
+
+					if (!std::is_sorted(ik.keys.begin(), ik.keys.end(), by_frame)) {
+						auto& copy = ik_copies.emplace_back(ik.keys.begin(), ik.keys.end());
+						std::stable_sort(copy.begin(), copy.end(), by_frame);
+						ik.keys = copy;
 					}
 				}
 
-				for (auto& [frame, key] : ex_keys) {
-					buff << frame;
-					buff << key.visible;
-					buff << static_cast<uint32_t>(key.iks.size());
+				auto merge = [&](bool write) {
+					uint32_t num_frames = 0;
+					size_t next_visibility = 0;
+					for (auto& ik : iks) {
+						ik.next = 0;
+					}
+
+					auto at_frame = [](const IkCursor& ik, uint64_t frame) {
+						return ik.next < ik.keys.size() && ik.keys[ik.next].frame == frame;
+					};
+
+					for (;;) {
+						uint64_t frame = UINT64_MAX;
+						if (next_visibility < visibility.size()) {
+							frame = visibility[next_visibility].frame;
+						}
+						for (auto& ik : iks) {
+							if (ik.next < ik.keys.size()) {
+								frame = std::min<uint64_t>(frame, ik.keys[ik.next].frame);
+							}
+						}
+
+						if (frame == UINT64_MAX) {
+							return num_frames;
+						}
+						++num_frames;
+
+						bool visible = true;
+						while (next_visibility < visibility.size() && visibility[next_visibility].frame == frame) {
+							visible = visibility[next_visibility++].visible;
+						}
+
+						uint32_t num_iks = 0;
+						for (auto& ik : iks) {
+							num_iks += at_frame(ik, frame);
+						}
+
+						if (write) {
+							buff << static_cast<uint32_t>(frame);
+							buff << visible;
+							buff << num_iks;
+						}
+
+						for (auto& ik : iks) {
+							if (!at_frame(ik, frame)) {
+								continue;
+							}
+
+							bool enable = false;
+							while (at_frame(ik, frame)) {
+								enable = ik.keys[ik.next++].enable;
+							}
 
-					for (auto& [name, ik] : key.iks) {
-						buff.as_texta<20>() << name;
-						buff << static_cast<uint8_t>(ik);
+							if (write) {
+								buff.write_array(ik.name.data(), ik.name.size());
+								buff << static_cast<uint8_t>(enable);
+							}
+						}
 					}
-				}
+				};
+
+				buff << merge(false);
+				merge(true);
 
 				return true;
 			}
 
-			bool export_vmd() {
+			// Writes every section through buff, which counts or stores the bytes depending on its mode.
+			bool export_sections() {
 				bool ret = export_header();
 				if (ret) ret = export_motions();
 				if (ret) ret = export_morphs();
@@ -2191,14 +3865,223 @@ namespace poml {
 
 				return ret;
 			}
+
+			// Exact size of the image.
+			size_t measure() {
+				buff.measure();
+				export_sections();
+				return buff.size();
+			}
+
+			// Writes the image into dst, which must be measure() bytes.
+			bool export_to(std::byte* dst, size_t size) {
+				buff.attach(dst, size);
+				return export_sections() && !buff.is_overflown() && buff.size() == size;
+			}
+
+			// Streams the image to sink in chunks of chunk_size bytes.
+			bool export_to(const Sink& sink, size_t chunk_size = BufferWriterBase::DefaultChunkSize) {
+				buff.stream(sink, chunk_size);
+				const bool ret = export_sections();
+				return buff.finish() && ret;
+			}
+
+			// Writes the image into buff, allocated once with the measured size.
+			bool export_vmd() {
+				const size_t size = measure();
+				buff.allocate(size);
+				return export_to(buff.storage.get(), size);
+			}
+		};
+
+		// Zero-copy view of a VMD image. Records are decoded on access from the underlying bytes,
+		// which must outlive the view. Sections missing at the end of the image are treated as empty.
+		template<typename Vec3, typename Vec4>
+		struct VmdView {
+			static constexpr size_t HeaderSize = 50;
+
+			struct MotionRecord {
+				static constexpr size_t Size = 111;
+
+				const std::byte* ptr;
+
+				std::string_view name() const { return fixed_text(ptr, 15); }
+				uint32_t frame() const { return load<uint32_t>(ptr + 15); }
+				Vec3 position() const { return load<Vec3>(ptr + 19); }
+				Vec4 orientation() const { return load<Vec4>(ptr + 31); }
+				const int8_t* interpolation() const { return reinterpret_cast<const int8_t*>(ptr + 47); }
+				Interpolation ix() const { return curve(0); }
+				Interpolation iy() const { return curve(16); }
+				Interpolation iz() const { return curve(32); }
+				Interpolation ir() const { return curve(48); }
+				bool is_physics() const { return !(interpolation()[2] == 0x63 && interpolation()[3] == 0x0f); }
+
+				Interpolation curve(int offset) const {
+					auto interp = interpolation() + offset;
+					return { interp[0], interp[8], interp[4], interp[12] };
+				}
+			};
+
+			struct MorphRecord {
+				static constexpr size_t Size = 23;
+
+				const std::byte* ptr;
+
+				std::string_view name() const { return fixed_text(ptr, 15); }
+				uint32_t frame() const { return load<uint32_t>(ptr + 15); }
+				float value() const { return load<float>(ptr + 19); }
+			};
+
+			struct CameraRecord {
+				static constexpr size_t Size = 61;
+
+				const std::byte* ptr;
+
+				uint32_t frame() const { return load<uint32_t>(ptr); }
+				float distance() const { return load<float>(ptr + 4); }
+				Vec3 position() const { return load<Vec3>(ptr + 8); }
+				Vec3 rotation() const { return load<Vec3>(ptr + 20); }
+				Interpolation ix() const { return load<Interpolation>(ptr + 32); }
+				Interpolation iy() const { return load<Interpolation>(ptr + 36); }
+				Interpolation iz() const { return load<Interpolation>(ptr + 40); }
+				Interpolation ir() const { return load<Interpolation>(ptr + 44); }
+				Interpolation id() const { return load<Interpolation>(ptr + 48); }
+				Interpolation iv() const { return load<Interpolation>(ptr + 52); }
+				int32_t view_angle() const { return load<int32_t>(ptr + 56); }
+				bool orthographic() const { return load<uint8_t>(ptr + 60) != 0; }
+			};
+
+			struct LightRecord {
+				static constexpr size_t Size = 28;
+
+				const std::byte* ptr;
+
+				uint32_t frame() const { return load<uint32_t>(ptr); }
+				Vec3 color() const { return load<Vec3>(ptr + 4); }
+				Vec3 position() const { return load<Vec3>(ptr + 16); }
+			};
+
+			struct ShadowRecord {
+				static constexpr size_t Size = 9;
+
+				const std::byte* ptr;
+
+				uint32_t frame() const { return load<uint32_t>(ptr); }
+				int8_t type() const { return load<int8_t>(ptr + 4); }
+				float distance() const { return load<float>(ptr + 5); }
+			};
+
+			template<typename Record>
+			struct Records {
+				using record_type = Record;
+
+				const std::byte* first = nullptr;
+				size_t count = 0;
+
+				struct iterator {
+					const std::byte* ptr;
+
+					Record operator*() const { return { ptr }; }
+					iterator& operator++() { ptr += Record::Size; return *this; }
+					bool operator==(const iterator&) const = default;
+				};
+
+				iterator begin() const { return { first }; }
+				iterator end() const { return { first + count * Record::Size }; }
+				size_t size() const { return count; }
+				bool empty() const { return count == 0; }
+				Record operator[](size_t i) const { return { first + i * Record::Size }; }
+			};
+
+			std::string_view name;
+			Records<MotionRecord> motions;
+			Records<MorphRecord> morphs;
+			Records<CameraRecord> cameras;
+			Records<LightRecord> lights;
+			Records<ShadowRecord> shadows;
+			size_t num_ex_keys = 0;
+
+			static std::string_view fixed_text(const std::byte* src, size_t N) {
+				auto text = reinterpret_cast<const char*>(src);
+				auto nul = static_cast<const char*>(std::memchr(text, 0, N));
+				return { text, nul ? static_cast<size_t>(nul - text) : N };
+			}
+
+			// Validates the layout of every section and locates the records.
+			bool parse(const void* data, size_t size) {
+				auto ptr = static_cast<const std::byte*>(data);
+				auto end = ptr + size;
+
+				if (size < HeaderSize || std::memcmp(ptr, VmdBase<Vec3, Vec4>::Magic, sizeof(VmdBase<Vec3, Vec4>::Magic)) != 0) {
+					return false;
+				}
+
+				name = fixed_text(ptr + 30, 20);
+				ptr += HeaderSize;
+
+				auto section = [&](auto& records) {
+					using Record = typename std::remove_reference_t<decltype(records)>::record_type;
+					records = {};
+
+					if (ptr == end) {
+						return true;
+					}
+					else if (end - ptr < 4) {
+						return false;
+					}
+
+					size_t count = load<uint32_t>(ptr);
+					constexpr size_t record_size = Record::Size;
+					if (static_cast<size_t>(end - ptr - 4) / record_size < count) {
+						return false;
+					}
+
+					records.first = ptr + 4;
+					records.count = count;
+					ptr += 4 + count * record_size;
+					return true;
+				};
+
+				if (!section(motions) || !section(morphs) || !section(cameras) || !section(lights) || !section(shadows)) {
+					return false;
+				}
+
+				num_ex_keys = 0;
+				if (ptr == end) {
+					return true;
+				}
+				else if (end - ptr < 4) {
+					return false;
+				}
+
+				size_t count = load<uint32_t>(ptr);
+				ptr += 4;
+
+				for (size_t i = 0; i < count; ++i) {
+					if (end - ptr < 9) {
+						return false;
+					}
+
+					size_t num_iks = load<uint32_t>(ptr + 5);
+					ptr += 9;
+
+					if (static_cast<size_t>(end - ptr) / 21 < num_iks) {
+						return false;
+					}
+					ptr += num_iks * 21;
+				}
+
+				num_ex_keys = count;
+				return ptr == end;
+			}
 		};
 
 	} // namespace io
 
 	template<typename Pmx, typename Path>
 	inline bool import_pmx(const Path& path, Pmx& pmx) {
-		auto bin = io::load_binary(path);
-		io::PmxImporter importer(pmx, bin.data(), bin.size());
+		io::MappedFile file(path);
+		io::PmxImporter importer(pmx, file.data(), file.size());
 		return importer.import_pmx();
 	}
 
@@ -2208,32 +4091,67 @@ namespace poml {
 		return importer.import_pmx();
 	}
 
+	// Same result as import_pmx, with vertices decoded on several threads. 0 means one per hardware thread.
 	template<typename Pmx, typename Path>
-	inline bool export_pmx(const Pmx& pmx, const Path& path) {
+	inline bool import_pmx_parallel(const Path& path, Pmx& pmx, unsigned num_threads = 0) {
+		io::MappedFile file(path);
+		io::PmxImporter importer(pmx, file.data(), file.size(), io::make_thread_executor(num_threads));
+		return importer.import_pmx();
+	}
+
+	template<typename Pmx>
+	inline bool import_pmx_parallel(const void* data, size_t size, Pmx& pmx, unsigned num_threads = 0) {
+		io::PmxImporter importer(pmx, data, size, io::make_thread_executor(num_threads));
+		return importer.import_pmx();
+	}
+
+	// Same as above with the loops run by the host, e.g. on its task scheduler.
+	template<typename Pmx>
+	inline bool import_pmx_parallel(const void* data, size_t size, Pmx& pmx, const io::Executor& executor) {
+		io::PmxImporter importer(pmx, data, size, executor);
+		return importer.import_pmx();
+	}
+
+	// Streams the image to sink in chunks, so that no more than two chunks are held in memory.
+	template<typename Pmx>
+	inline bool stream_pmx(const Pmx& pmx, const io::Sink& sink, size_t chunk_size = io::BufferWriterBase::DefaultChunkSize) {
 		io::PmxExporter exporter(pmx);
-		if (!exporter.export_pmx()) {
-			return false;
-		}
+		return exporter.export_to(sink, chunk_size);
+	}
 
-		return io::save_binary(path, exporter.buff.data(), exporter.buff.size());
+	template<typename Pmx, typename Path>
+	inline bool export_pmx(const Pmx& pmx, const Path& path) {
+		return io::replace_file(path, [&](const io::Sink& sink) {
+			return stream_pmx(pmx, sink);
+		});
 	}
 
 	template<typename Pmx, typename Elem = std::byte>
-	inline bool export_pmx(const Pmx& pmx, Track<Elem>& bin) {
+	inline bool export_pmx(const Pmx& pmx, std::vector<Elem>& bin) {
+		static_assert(sizeof(Elem) == 1);
+
 		io::PmxExporter exporter(pmx);
-		if (!exporter.export_pmx()) {
-			return false;
-		}
+		bin.resize(exporter.measure());
+		return exporter.export_to(reinterpret_cast<std::byte*>(bin.data()), bin.size());
+	}
 
-		bin.resize(exporter.buff.size());
-		std::memcpy(bin.data(), exporter.buff.data(), exporter.buff.size());
-		return true;
+	template<typename Pmx>
+	inline size_t measure_pmx(const Pmx& pmx) {
+		io::PmxExporter exporter(pmx);
+		return exporter.measure();
+	}
+
+	// Writes into a caller-provided span such as a mapped file, which must be measure_pmx() bytes.
+	template<typename Pmx>
+	inline bool export_pmx(const Pmx& pmx, void* data, size_t size) {
+		io::PmxExporter exporter(pmx);
+		return exporter.export_to(static_cast<std::byte*>(data), size);
 	}
 
 	template<typename Vmd, typename Path>
 	inline bool import_vmd(const Path& path, Vmd& vmd) {
-		auto bin = io::load_binary(path);
-		io::VmdImporter importer(vmd, bin.data(), bin.size());
+		io::MappedFile file(path);
+		io::VmdImporter importer(vmd, file.data(), file.size());
 		return importer.import_vmd();
 	}
 
@@ -2244,25 +4162,64 @@ namespace poml {
 	}
 
 	template<typename Vmd, typename Path>
-	inline bool export_vmd(const Vmd& vmd, const Path& path) {
+	inline bool import_vmd_parallel(const Path& path, Vmd& vmd, unsigned num_threads = 0) {
+		io::MappedFile file(path);
+		io::VmdImporter importer(vmd, file.data(), file.size(), io::make_thread_executor(num_threads));
+		return importer.import_vmd_parallel();
+	}
+
+	template<typename Vmd>
+	inline bool import_vmd_parallel(const void* data, size_t size, Vmd& vmd, unsigned num_threads = 0) {
+		io::VmdImporter importer(vmd, data, size, io::make_thread_executor(num_threads));
+		return importer.import_vmd_parallel();
+	}
+
+	// Same as above with the loops run by the host, e.g. on its task scheduler.
+	template<typename Vmd>
+	inline bool import_vmd_parallel(const void* data, size_t size, Vmd& vmd, const io::Executor& executor) {
+		io::VmdImporter importer(vmd, data, size, executor);
+		return importer.import_vmd_parallel();
+	}
+
+	template<typename View>
+	inline bool view_vmd(const void* data, size_t size, View& view) {
+		return view.parse(data, size);
+	}
+
+	// Streams the image to sink in chunks, so that no more than two chunks are held in memory.
+	template<typename Vmd>
+	inline bool stream_vmd(const Vmd& vmd, const io::Sink& sink, size_t chunk_size = io::BufferWriterBase::DefaultChunkSize) {
 		io::VmdExporter exporter(vmd);
-		if (!exporter.export_vmd()) {
-			return false;
-		}
+		return exporter.export_to(sink, chunk_size);
+	}
 
-		return io::save_binary(path, exporter.buff.data(), exporter.buff.size());
+	template<typename Vmd, typename Path>
+	inline bool export_vmd(const Vmd& vmd, const Path& path) {
+		return io::replace_file(path, [&](const io::Sink& sink) {
+			return stream_vmd(vmd, sink);
+		});
 	}
 
 	template<typename Vmd, typename Elem = std::byte>
-	inline bool export_vmd(const Vmd& vmd, Track<Elem>& bin) {
+	inline bool export_vmd(const Vmd& vmd, std::vector<Elem>& bin) {
+		static_assert(sizeof(Elem) == 1);
+
 		io::VmdExporter exporter(vmd);
-		if (!exporter.export_vmd()) {
-			return false;
-		}
+		bin.resize(exporter.measure());
+		return exporter.export_to(reinterpret_cast<std::byte*>(bin.data()), bin.size());
+	}
 
-		bin.resize(exporter.buff.size());
-		std::memcpy(bin.data(), exporter.buff.data(), exporter.buff.size());
-		return true;
+	template<typename Vmd>
+	inline size_t measure_vmd(const Vmd& vmd) {
+		io::VmdExporter exporter(vmd);
+		return exporter.measure();
+	}
+
+	// Writes into a caller-provided span such as a mapped file, which must be measure_vmd() bytes.
+	template<typename Vmd>
+	inline bool export_vmd(const Vmd& vmd, void* data, size_t size) {
+		io::VmdExporter exporter(vmd);
+		return exporter.export_to(static_cast<std::byte*>(data), size);
 	}
 
 } // namespace poml 